@@ -9,6 +9,9 @@ class ProxyPDF(ConanFile):
         self.requires("fmt/9.1.0")
         self.requires("qt/6.7.3")
         self.requires("opencv/4.11.0")
+        self.requires("libpng/1.6.44")
+        self.requires("zlib/1.3.1")
+        self.requires("xxhash/0.8.2")
         self.requires("libharu/2.4.4")
         self.requires("podofo/0.9.7")
         self.requires("nlohmann_json/3.11.3")
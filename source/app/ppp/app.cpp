@@ -71,7 +71,7 @@ const std::string& PrintProxyPrepApplication::GetTheme() const
     return m_Theme;
 }
 
-void PrintProxyPrepApplication::SetCube(std::string cube_name, cv::Mat cube)
+void PrintProxyPrepApplication::SetCube(std::string cube_name, ColorCube cube)
 {
     std::lock_guard lock{ m_CubesMutex };
     if (!m_Cubes.contains(cube_name))
@@ -79,7 +79,7 @@ void PrintProxyPrepApplication::SetCube(std::string cube_name, cv::Mat cube)
         m_Cubes[std::move(cube_name)] = std::move(cube);
     }
 }
-const cv::Mat* PrintProxyPrepApplication::GetCube(const std::string& cube_name) const
+const ColorCube* PrintProxyPrepApplication::GetCube(const std::string& cube_name) const
 {
     std::lock_guard lock{ m_CubesMutex };
     if (m_Cubes.contains(cube_name))
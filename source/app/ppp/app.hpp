@@ -4,8 +4,7 @@
 
 #include <QApplication>
 
-#include <opencv2/core/mat.hpp>
-
+#include <ppp/color_cube.hpp>
 #include <ppp/constants.hpp>
 #include <ppp/util.hpp>
 
@@ -26,8 +25,8 @@ class PrintProxyPrepApplication : public QApplication
     void SetTheme(std::string theme);
     const std::string& GetTheme() const;
 
-    void SetCube(std::string cube_name, cv::Mat cube);
-    const cv::Mat* GetCube(const std::string& cube_name) const;
+    void SetCube(std::string cube_name, ColorCube cube);
+    const ColorCube* GetCube(const std::string& cube_name) const;
 
     bool GetObjectVisibility(const QString& object_name) const;
     void SetObjectVisibility(const QString& object_name, bool visible);
@@ -44,7 +43,7 @@ class PrintProxyPrepApplication : public QApplication
     std::string m_Theme{ "Default" };
 
     mutable std::mutex m_CubesMutex;
-    std::unordered_map<std::string, cv::Mat> m_Cubes;
+    std::unordered_map<std::string, ColorCube> m_Cubes;
 
     std::unordered_map<QString, bool> m_ObjectVisibilities;
 
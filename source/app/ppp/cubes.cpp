@@ -8,6 +8,7 @@
 #include <QStyleFactory>
 
 #include <ppp/app.hpp>
+#include <ppp/color_cube.hpp>
 #include <ppp/project/image_ops.hpp>
 
 std::vector<std::string> GetCubeNames()
@@ -52,10 +53,16 @@ void PreloadCube(PrintProxyPrepApplication& application, std::string_view cube_n
         Q_INIT_RESOURCE(resources);
         cube_path = fmt::format(":/res/cubes/{}.CUBE", cube_name);
     }
-    application.SetCube(std::string{ cube_name }, LoadColorCube(cube_path));
+    // Compile the cube right away, so applying it later needs no further preparation,
+    // compiled cubes are cached so we only parse each .cube file once
+    ColorCube color_cube{ LoadCompiledColorCube(cube_path, "./res/cubes/compiled") };
+    if (color_cube)
+    {
+        application.SetCube(std::string{ cube_name }, std::move(color_cube));
+    }
 }
 
-const cv::Mat* GetCubeImage(PrintProxyPrepApplication& application, std::string_view cube_name)
+const ColorCube* GetCubeImage(PrintProxyPrepApplication& application, std::string_view cube_name)
 {
     PreloadCube(application, cube_name);
     return application.GetCube(std::string{ cube_name });
@@ -258,6 +258,10 @@ int main(int argc, char** argv)
     // Write preview to project and forward to widgets
     QObject::connect(&cropper, &Cropper::PreviewUpdated, &project, &Project::SetPreview);
 
+    // Generate previews for whatever the user is looking at first
+    QObject::connect(scroll_area, &CardScrollArea::VisibleCardsChanged, &cropper, &Cropper::VisibleCardsChanged);
+    QObject::connect(print_preview, &PrintPreview::VisibleCardsChanged, &cropper, &Cropper::VisibleCardsChanged);
+
     // Enable and disable Render button
     QObject::connect(&cropper, &Cropper::CropWorkStart, actions, &ActionsWidget::CropperWorking);
     QObject::connect(&cropper, &Cropper::CropWorkDone, actions, &ActionsWidget::CropperDone);
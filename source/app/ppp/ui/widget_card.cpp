@@ -8,6 +8,7 @@
 #include <QPixmap>
 #include <QPushButton>
 #include <QResizeEvent>
+#include <QScrollArea>
 #include <QStackedLayout>
 #include <QSvgRenderer>
 #include <QSvgWidget>
@@ -112,6 +113,11 @@ void CardImage::Refresh(const fs::path& image_name, const Project& project, Para
     QObject::connect(&project, &Project::PreviewUpdated, this, &CardImage::PreviewUpdated);
 }
 
+const fs::path& CardImage::GetImageName() const
+{
+    return m_ImageName;
+}
+
 int CardImage::heightForWidth(int width) const
 {
     float card_ratio{ m_CardRatio };
@@ -238,6 +244,38 @@ void BacksideImage::Refresh(const fs::path& backside_name, Pixel minimum_width,
         CardImage::Params{ .m_MinimumWidth{ minimum_width } });
 }
 
+std::vector<fs::path> GetVisibleCardImages(const QScrollArea* scroll_area)
+{
+    std::vector<fs::path> visible_cards{};
+    if (scroll_area->widget() == nullptr)
+    {
+        return visible_cards;
+    }
+
+    const QWidget* viewport{ scroll_area->viewport() };
+    const QRect viewport_rect{ viewport->rect() };
+    for (const CardImage* card_image : scroll_area->widget()->findChildren<CardImage*>())
+    {
+        if (!card_image->isVisible())
+        {
+            continue;
+        }
+
+        const QRect card_rect{ card_image->mapTo(viewport, QPoint{ 0, 0 }), card_image->size() };
+        if (!viewport_rect.intersects(card_rect))
+        {
+            continue;
+        }
+
+        const fs::path& image_name{ card_image->GetImageName() };
+        if (!std::ranges::contains(visible_cards, image_name))
+        {
+            visible_cards.push_back(image_name);
+        }
+    }
+    return visible_cards;
+}
+
 StackedCardBacksideView::StackedCardBacksideView(QWidget* image, QWidget* backside)
 {
     QCommonStyle style{};
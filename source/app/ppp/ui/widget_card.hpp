@@ -3,9 +3,13 @@
 #include <QLabel>
 #include <QStackedWidget>
 
+#include <vector>
+
 #include <ppp/image.hpp>
 #include <ppp/util.hpp>
 
+class QScrollArea;
+
 class Project;
 struct ImagePreview;
 
@@ -26,6 +30,8 @@ class CardImage : public QLabel
 
     void Refresh(const fs::path& image_name, const Project& project, Params params);
 
+    const fs::path& GetImageName() const;
+
     virtual bool hasHeightForWidth() const override
     {
         return true;
@@ -61,6 +67,9 @@ class BacksideImage : public CardImage
     void Refresh(const fs::path& backside_name, Pixel minimum_width, const Project& project);
 };
 
+// Collects the names of all card images that are currently visible in the scroll area's viewport
+std::vector<fs::path> GetVisibleCardImages(const QScrollArea* scroll_area);
+
 class StackedCardBacksideView : public QStackedWidget
 {
     Q_OBJECT
@@ -7,6 +7,7 @@
 #include <QPainterPath>
 #include <QResizeEvent>
 #include <QScrollBar>
+#include <QTimer>
 
 #include <ppp/constants.hpp>
 #include <ppp/util.hpp>
@@ -558,6 +559,11 @@ PrintPreview::PrintPreview(const Project& project)
     Refresh();
     setWidgetResizable(true);
     setFrameShape(QFrame::Shape::NoFrame);
+
+    QObject::connect(verticalScrollBar(),
+                     &QScrollBar::valueChanged,
+                     this,
+                     &PrintPreview::QueueVisibleCardsUpdate);
 }
 
 void PrintPreview::Refresh()
@@ -655,4 +661,39 @@ void PrintPreview::Refresh()
     setWidget(pages_widget);
 
     verticalScrollBar()->setValue(current_scroll);
+    QueueVisibleCardsUpdate();
+}
+
+void PrintPreview::QueueVisibleCardsUpdate()
+{
+    if (m_VisibleCardsUpdateQueued)
+    {
+        return;
+    }
+
+    m_VisibleCardsUpdateQueued = true;
+    QTimer::singleShot(0,
+                       this,
+                       [this]()
+                       {
+                           m_VisibleCardsUpdateQueued = false;
+                           if (isVisible())
+                           {
+                               VisibleCardsChanged(GetVisibleCardImages(this));
+                           }
+                       });
+}
+
+void PrintPreview::showEvent(QShowEvent* event)
+{
+    QScrollArea::showEvent(event);
+
+    QueueVisibleCardsUpdate();
+}
+
+void PrintPreview::resizeEvent(QResizeEvent* event)
+{
+    QScrollArea::resizeEvent(event);
+
+    QueueVisibleCardsUpdate();
 }
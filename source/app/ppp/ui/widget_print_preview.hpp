@@ -1,18 +1,35 @@
 #pragma once
 
+#include <vector>
+
 #include <QScrollArea>
 
+#include <ppp/util.hpp>
+
 class Project;
 
 class PrintPreview : public QScrollArea
 {
+    Q_OBJECT
+
   public:
     PrintPreview(const Project& project);
 
     void Refresh();
 
+  signals:
+    void VisibleCardsChanged(const std::vector<fs::path>& card_names);
+
   private:
+    // Defers until layouting is done, then emits VisibleCardsChanged
+    void QueueVisibleCardsUpdate();
+
+    virtual void showEvent(QShowEvent* event) override;
+    virtual void resizeEvent(QResizeEvent* event) override;
+
     class PagePreview;
 
     const Project& m_Project;
+
+    bool m_VisibleCardsUpdateQueued{ false };
 };
@@ -8,6 +8,7 @@
 #include <QPushButton>
 #include <QResizeEvent>
 #include <QScrollBar>
+#include <QTimer>
 
 #include <ppp/qt_util.hpp>
 #include <ppp/util.hpp>
@@ -618,6 +619,11 @@ CardScrollArea::CardScrollArea(Project& project)
                      this,
                      reset_number);
 
+    QObject::connect(verticalScrollBar(),
+                     &QScrollBar::valueChanged,
+                     this,
+                     &CardScrollArea::QueueVisibleCardsUpdate);
+
     m_Grid = card_grid;
 }
 
@@ -664,6 +670,7 @@ void CardScrollArea::FullRefresh()
 {
     m_Grid->FullRefresh();
     setMinimumWidth(ComputeMinimumWidth());
+    QueueVisibleCardsUpdate();
 }
 
 int CardScrollArea::ComputeMinimumWidth()
@@ -672,11 +679,39 @@ int CardScrollArea::ComputeMinimumWidth()
     return m_Grid->minimumWidth() + 2 * verticalScrollBar()->width() + margins.left() + margins.right();
 }
 
+void CardScrollArea::QueueVisibleCardsUpdate()
+{
+    if (m_VisibleCardsUpdateQueued)
+    {
+        return;
+    }
+
+    m_VisibleCardsUpdateQueued = true;
+    QTimer::singleShot(0,
+                       this,
+                       [this]()
+                       {
+                           m_VisibleCardsUpdateQueued = false;
+                           if (isVisible())
+                           {
+                               VisibleCardsChanged(GetVisibleCardImages(this));
+                           }
+                       });
+}
+
 void CardScrollArea::showEvent(QShowEvent* event)
 {
     QScrollArea::showEvent(event);
 
     setMinimumWidth(ComputeMinimumWidth());
+    QueueVisibleCardsUpdate();
+}
+
+void CardScrollArea::resizeEvent(QResizeEvent* event)
+{
+    QScrollArea::resizeEvent(event);
+
+    QueueVisibleCardsUpdate();
 }
 
 #include <widget_scroll_area.moc>
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <QScrollArea>
 
 #include <ppp/util.hpp>
@@ -8,9 +10,14 @@ class Project;
 
 class CardScrollArea : public QScrollArea
 {
+    Q_OBJECT
+
   public:
     CardScrollArea(Project& project);
 
+  signals:
+    void VisibleCardsChanged(const std::vector<fs::path>& card_names);
+
   public slots:
     void NewProjectOpened();
     void ImageDirChanged();
@@ -27,10 +34,16 @@ class CardScrollArea : public QScrollArea
   private:
     int ComputeMinimumWidth();
 
+    // Defers until layouting is done, then emits VisibleCardsChanged
+    void QueueVisibleCardsUpdate();
+
     virtual void showEvent(QShowEvent* event) override;
+    virtual void resizeEvent(QResizeEvent* event) override;
 
     Project& m_Project;
 
     class CardGrid;
     CardGrid* m_Grid;
+
+    bool m_VisibleCardsUpdateQueued{ false };
 };
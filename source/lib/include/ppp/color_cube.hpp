@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+// A color cube as described by a .cube file, before compilation
+struct ColorCubeLattice
+{
+    // Size x size x size lattice of CV_8UC3 nodes, empty if the file could not be parsed
+    cv::Mat m_Lattice;
+
+    // Range of input values the lattice spans, per channel in the order of the file
+    std::array<float, 3> m_DomainMin{ 0.0f, 0.0f, 0.0f };
+    std::array<float, 3> m_DomainMax{ 1.0f, 1.0f, 1.0f };
+};
+
+// A color cube compiled for application, built once per cube and shared by everyone applying it
+//
+// The lattice is padded by one node along each axis, replicating the last node, so interpolation
+// never has to clamp, and each node is packed into 32 bits in a cache-aligned buffer so all three
+// channels of a corner are fetched in one load. Per-channel tables map every 8-bit input value to
+// its lattice offset and an 8-bit interpolation weight, so applying the cube is integer-only.
+class ColorCube
+{
+  public:
+    ColorCube() = default;
+    // Compiles a lattice as returned by LoadColorCube
+    explicit ColorCube(const ColorCubeLattice& lattice);
+
+    ColorCube(ColorCube&&) = default;
+    ColorCube& operator=(ColorCube&&) = default;
+
+    explicit operator bool() const;
+    bool Valid() const;
+
+    // Number of nodes along each axis, not counting the padding
+    int LatticeSize() const;
+
+    // Applies the cube to a 3- or 4-channel 8-bit image, alpha is passed through,
+    // output has to be allocated with the same size and type as input
+    void Apply(const cv::Mat& input, cv::Mat& output) const;
+
+    // Binary form of the compiled cube, loading it only needs to copy the lattice and rebuild the small tables
+    std::vector<std::byte> Serialize() const;
+    // Returns an invalid cube if the data was not produced by a compatible Serialize
+    static ColorCube Deserialize(std::span<const std::byte> data);
+
+  private:
+    void AllocateNodes();
+    void BuildTables();
+
+    struct AlignedDelete
+    {
+        void operator()(uint32_t* nodes) const;
+    };
+
+    int m_LatticeSize{ 0 };
+    std::array<float, 3> m_DomainMin{ 0.0f, 0.0f, 0.0f };
+    std::array<float, 3> m_DomainMax{ 1.0f, 1.0f, 1.0f };
+    std::unique_ptr<uint32_t[], AlignedDelete> m_Nodes{};
+
+    // Indexed by [r, g, b] - input channels 2, 1, 0 - and then by channel value,
+    // stored as 32-bit so they can be used with vector gathers
+    std::array<std::array<int32_t, 256>, 3> m_Offsets{};
+    std::array<std::array<uint32_t, 256>, 3> m_Weights{};
+};
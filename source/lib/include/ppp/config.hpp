@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <optional>
@@ -20,6 +21,15 @@ enum class ImageFormat
     Jpg
 };
 
+// Maps to the zlib strategies
+enum class PngStrategy
+{
+    Default,
+    Filtered,
+    HuffmanOnly,
+    Rle,
+};
+
 enum class PageOrientation
 {
     Portrait,
@@ -56,6 +66,40 @@ struct Config
     std::optional<int> m_JpgQuality{ std::nullopt };
     UnitInfo m_BaseUnit{ c_SupportedBaseUnits[0] };
 
+    // Number of worker threads the cropper uses, 0 means one per hardware thread
+    uint32_t m_CropperThreads{ 0 };
+
+    struct CropStageConfig
+    {
+        // Number of threads working on this stage, 0 means an even share of the hardware threads
+        // split between all stages set to 0, the kernels inside the stages are parallel already
+        uint32_t m_Threads;
+        // Number of jobs that can wait for this stage before the previous stage blocks
+        uint32_t m_QueueDepth;
+    };
+    CropStageConfig m_CropDecodeStage{ 2, 4 };
+    CropStageConfig m_CropTransformStage{ 2, 4 };
+    CropStageConfig m_CropEncodeStage{ 2, 4 };
+    CropStageConfig m_CropWriteStage{ 2, 4 };
+
+    // Compression of cropped PNGs, large crops are deflated in independent chunks across threads when parallel
+    int m_CropPngCompression{ 3 };
+    PngStrategy m_CropPngStrategy{ PngStrategy::Default };
+    bool m_CropPngParallel{ true };
+
+    // Identical source images are cropped and previewed only once, near duplicates are opt-in since they are lossy
+    bool m_DeduplicateCards{ true };
+    bool m_DetectNearDuplicates{ false };
+
+    // Crops are stored once per unique source and parameters, card outputs are hard links into the store
+    bool m_ContentAddressedCrops{ false };
+
+    // Dumps cropper timings and counters next to the crops whenever a batch of crop work is done
+    bool m_DumpCropperMetrics{ false };
+
+    // Memory budget in megabytes for decoded source images shared between crop and preview work
+    uint32_t m_ImageCacheSize{ 1024 };
+
     std::unordered_map<std::string, bool> m_PluginsState;
 
     static inline constexpr std::string_view c_FitSize{ "Fit" };
@@ -147,6 +191,10 @@ struct Config
 
     void SetPdfBackend(PdfBackend backend);
 
+    // All crop pipeline stages in processing order, paired with their names
+    std::array<std::pair<std::string_view, CropStageConfig*>, 4> CropStages();
+    std::array<std::pair<std::string_view, const CropStageConfig*>, 4> CropStages() const;
+
     static inline constexpr std::array c_SupportedBaseUnits{
         UnitInfo{
             "mm",
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <QByteArray>
+
+#include <ppp/util.hpp>
+
+// Identifies one version of a file without reading it, as long as none of
+// these change the contents of the file are assumed to be unchanged
+struct FileStat
+{
+    uintmax_t m_Size{ 0 };
+    int64_t m_WriteTime{ 0 };
+    uint64_t m_Inode{ 0 };
+
+    bool operator==(const FileStat&) const = default;
+};
+
+// Returns nothing if the file does not exist or can't be queried
+std::optional<FileStat> StatFile(const fs::path& path);
+
+// 128-bit XXH3 of the given bytes, not cryptographic but plenty to detect changes to a file
+QByteArray HashBytes(std::span<const std::byte> bytes);
+
+// Same as HashBytes over the file contents, the file is streamed in chunks so it is never
+// read into memory as a whole, returns an empty hash on failure
+QByteArray HashFile(const fs::path& path);
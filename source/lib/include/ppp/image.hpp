@@ -9,10 +9,13 @@
 #include <ppp/util.hpp>
 
 class QPixmap;
+class ColorCube;
 
 using EncodedImage = std::vector<std::byte>;
 using EncodedImageView = std::span<const std::byte>;
 
+// Copies of an image share their pixels, no operation modifies an image in place, so sharing is
+// only broken when someone asks for write access through GetMutableUnderlying or for a Clone
 class [[nodiscard]] Image
 {
   public:
@@ -26,9 +29,16 @@ class [[nodiscard]] Image
     Image& operator=(Image&& rhs);
     Image& operator=(const Image& rhs);
 
+    // Deep copy that does not share pixels with this image
+    Image Clone() const;
+
     static Image Read(const fs::path& path);
+    // Reads the image already scaled to the given size, decoding JPEGs at reduced resolution
+    // and halving other formats with a pyramid before the final resize, meant for previews
+    static Image ReadScaled(const fs::path& path, PixelSize target_size);
     bool Write(const fs::path& path, std::optional<int32_t> png_compression = std::nullopt, std::optional<int32_t> jpg_quality = std::nullopt) const;
     bool Write(const fs::path& path, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality, Size dimensions) const;
+    static bool WriteEncoded(const fs::path& path, EncodedImageView buffer);
 
     static Image Decode(const EncodedImage& buffer);
     static Image Decode(EncodedImageView buffer);
@@ -36,6 +46,9 @@ class [[nodiscard]] Image
     EncodedImage EncodePng(std::optional<int32_t> compression = std::nullopt) const;
     EncodedImage EncodeJpg(std::optional<int32_t> quality = std::nullopt) const;
 
+    // Encodes in the format of the given extension, embedding the density this image has at the given dimensions
+    EncodedImage Encode(const fs::path& extension, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality, Size dimensions) const;
+
     QPixmap StoreIntoQtPixmap() const;
 
     explicit operator bool() const;
@@ -54,9 +67,13 @@ class [[nodiscard]] Image
     Image AddBlackBorder(Pixel left, Pixel top, Pixel right, Pixel bottom) const;
     Image AddReflectBorder(Pixel left, Pixel top, Pixel right, Pixel bottom) const;
 
+    // Only touches the four corners, 3-channel images get an opaque alpha channel first
     Image RoundCorners(::Size real_size, ::Length corner_radius) const;
+    // Antialiased alpha of a top-left corner of the given radius, the other corners are its mirror images,
+    // built once per radius and shared by every card rounded at that radius
+    static cv::Mat CornerStencil(int radius_pixels);
 
-    Image ApplyColorCube(const cv::Mat& color_cube) const;
+    Image ApplyColorCube(const ColorCube& color_cube) const;
 
     Image Resize(PixelSize size) const;
 
@@ -68,11 +85,14 @@ class [[nodiscard]] Image
     uint64_t Hash() const;
 
     const cv::Mat& GetUnderlying() const;
+    // Detaches from any other image sharing the same pixels before handing them out for writing
+    cv::Mat& GetMutableUnderlying();
 
     void DebugDisplay() const;
 
   private:
     void Release();
+    void Detach();
 
     cv::Mat m_Impl{};
 };
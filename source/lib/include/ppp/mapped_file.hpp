@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+
+#include <ppp/util.hpp>
+
+class QFile;
+
+// Read-only view of a whole file mapped into memory, the view stays valid as long as this object lives
+//
+// Only map files we write ourselves, a file truncated by someone else while mapped faults on access
+class MappedFile
+{
+  public:
+    // Returns nothing if the file can't be opened or mapped, empty files map to an empty view
+    static std::optional<MappedFile> Map(const fs::path& path);
+
+    MappedFile(MappedFile&& rhs) noexcept;
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+    ~MappedFile();
+
+    std::span<const std::byte> Bytes() const;
+
+  private:
+    MappedFile() = default;
+
+    std::unique_ptr<QFile> m_File;
+    std::span<const std::byte> m_Bytes;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <opencv2/core/mat.hpp>
+
+#include <ppp/config.hpp>
+#include <ppp/image.hpp>
+#include <ppp/util.hpp>
+
+struct PngWriteOptions
+{
+    // zlib compression level in [0, 9], when not set the writer tunes for speed the same way OpenCV does
+    std::optional<int32_t> m_Compression{ std::nullopt };
+    // Only used together with an explicit compression level
+    PngStrategy m_Strategy{ PngStrategy::Default };
+    // Large images are split into bands of rows that are filtered and deflated independently across
+    // threads, pigz-style, the bands are joined into a single valid zlib stream
+    bool m_Parallel{ false };
+    // Emitted as a pHYs chunk when set
+    std::optional<PixelDensity> m_Density{ std::nullopt };
+};
+
+// Writes 8- or 16-bit gray, BGR or BGRA images with libpng, rows are compressed straight
+// out of the image and the compressed stream goes to the file as it is produced
+bool WritePng(const fs::path& path, const cv::Mat& image, const PngWriteOptions& options);
+
+// Same as WritePng but appends the stream to a memory buffer, returns an empty buffer on failure
+EncodedImage EncodePng(const cv::Mat& image, const PngWriteOptions& options);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// A blocking FIFO with a fixed capacity, producers block while it is full and consumers block while it is empty
+template<class T>
+class BoundedQueue
+{
+  public:
+    explicit BoundedQueue(size_t capacity)
+        : m_Capacity{ std::max(capacity, size_t{ 1 }) }
+    {
+    }
+
+    // Blocks until there is space, returns false if the queue was closed in the meantime,
+    // in which case the value is not moved from
+    bool Push(T&& value)
+    {
+        std::unique_lock lock{ m_Mutex };
+        m_NotFull.wait(lock,
+                       [this]()
+                       { return m_Closed || m_Queue.size() < m_Capacity; });
+        if (m_Closed)
+        {
+            return false;
+        }
+
+        m_Queue.push_back(std::move(value));
+        m_PeakSize = std::max(m_PeakSize, m_Queue.size());
+        lock.unlock();
+
+        m_NotEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until there is a value, returns nothing once the queue is closed
+    std::optional<T> Pop()
+    {
+        std::unique_lock lock{ m_Mutex };
+        m_NotEmpty.wait(lock,
+                        [this]()
+                        { return m_Closed || !m_Queue.empty(); });
+        if (m_Closed)
+        {
+            return std::nullopt;
+        }
+
+        T value{ std::move(m_Queue.front()) };
+        m_Queue.pop_front();
+        lock.unlock();
+
+        m_NotFull.notify_one();
+        return value;
+    }
+
+    // Wakes up all producers and consumers, values that are still queued are returned
+    std::deque<T> Close()
+    {
+        std::deque<T> left_over{};
+        {
+            std::lock_guard lock{ m_Mutex };
+            m_Closed = true;
+            std::swap(left_over, m_Queue);
+        }
+
+        m_NotFull.notify_all();
+        m_NotEmpty.notify_all();
+        return left_over;
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard lock{ m_Mutex };
+        return m_Queue.size();
+    }
+    size_t Capacity() const
+    {
+        return m_Capacity;
+    }
+
+    // Largest size the queue had since the last call
+    size_t TakePeakSize()
+    {
+        std::lock_guard lock{ m_Mutex };
+        return std::exchange(m_PeakSize, m_Queue.size());
+    }
+
+  private:
+    const size_t m_Capacity;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_NotFull;
+    std::condition_variable m_NotEmpty;
+    std::deque<T> m_Queue;
+    size_t m_PeakSize{ 0 };
+    bool m_Closed{ false };
+};
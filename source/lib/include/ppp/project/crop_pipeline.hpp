@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <ppp/color_cube.hpp>
+#include <ppp/config.hpp>
+#include <ppp/image.hpp>
+#include <ppp/source_file.hpp>
+#include <ppp/util.hpp>
+
+#include <ppp/project/bounded_queue.hpp>
+#include <ppp/project/decoded_image_cache.hpp>
+#include <ppp/project/metrics.hpp>
+
+class QThread;
+
+enum class CropJobResult
+{
+    Success,
+    Cancelled,
+    Failed,
+};
+
+struct CropJob
+{
+    fs::path m_CardName;
+    fs::path m_InputFile;
+    // If set the input is decoded from this, so bytes that were already read for hashing are not read again
+    std::optional<SourceFile> m_Source;
+    fs::path m_OutputFile;
+
+    Size m_CardSize;
+    Length m_FullBleedEdge;
+    Length m_BleedEdge;
+    PixelDensity m_MaxDensity;
+    Size m_CardSizeWithBleed;
+
+    // No color correction is done when this is null
+    const ColorCube* m_ColorCube;
+
+    // Checked before each stage, cancelled jobs leave the pipeline immediately
+    std::function<bool()> m_IsCancelled;
+    // Called exactly once when the job leaves the pipeline, on whichever thread that happens
+    std::function<void(CropJobResult)> m_OnDone;
+
+    // Intermediate results passed from one stage to the next
+    Image m_Image;
+    EncodedImage m_Encoded;
+};
+
+// Runs crop jobs through decode -> transform -> encode -> write, each stage has
+// its own threads and a bounded input queue, so I/O and compute can overlap
+class CropPipeline
+{
+  public:
+    struct StageStats
+    {
+        std::string_view m_Name;
+        uint32_t m_Threads;
+        size_t m_QueueCapacity;
+        size_t m_Queued;
+        size_t m_PeakQueued;
+        uint32_t m_Busy;
+        uint64_t m_Processed;
+        // Fraction of the time the stage's threads were busy
+        float m_Utilization;
+    };
+
+    CropPipeline(const Config& config, DecodedImageCache& image_cache, MetricsRegistry& metrics);
+    ~CropPipeline();
+
+    // Blocks while the first stage is full, returns false if the pipeline was stopped
+    bool Submit(std::unique_ptr<CropJob> job);
+
+    // Joins all threads, jobs still waiting in a queue finish as cancelled
+    void Stop();
+
+    // Stats accumulated since the previous call
+    std::vector<StageStats> TakeStageStats();
+
+  private:
+    struct Stage
+    {
+        Stage(std::string_view name, size_t queue_depth, std::function<void(CropJob&)> work);
+
+        std::string_view m_Name;
+        std::string m_TimingMetric;
+        std::string m_QueueMetric;
+        std::function<void(CropJob&)> m_Work;
+        BoundedQueue<std::unique_ptr<CropJob>> m_Queue;
+        std::vector<QThread*> m_Threads;
+
+        std::atomic_uint32_t m_Busy{ 0 };
+        std::atomic_uint64_t m_Processed{ 0 };
+        std::atomic<std::chrono::nanoseconds::rep> m_BusyTime{ 0 };
+    };
+
+    void StageLoop(size_t stage_index);
+
+    MetricsRegistry& m_Metrics;
+
+    std::vector<std::unique_ptr<Stage>> m_Stages;
+
+    using time_point = decltype(std::chrono::steady_clock::now());
+    std::atomic<time_point> m_StatsStartPoint{};
+
+    bool m_Stopped{ false };
+};
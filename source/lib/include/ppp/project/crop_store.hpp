@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <QByteArray>
+
+#include <ppp/util.hpp>
+
+#include <ppp/project/image_database.hpp>
+
+// Content-addressed store of crops, each crop is stored once under a key derived from
+// the source contents and everything that determines how it is cropped, per-card outputs
+// are hard links into the store, so identical sources are cropped and stored only once
+//
+// Files linked into the store must never be written in place, replace them instead
+//
+// Stored crops are only ever referenced through hard links, since pruning relies on link counts,
+// on file systems without hard links nothing is stored and the store is effectively off
+class CropStore
+{
+  public:
+    static inline constexpr std::string_view c_DirName{ ".store" };
+
+    explicit CropStore(const fs::path& crop_dir);
+
+    // Identifies a crop of the given source, the key ends in the output extension
+    static std::string Key(const QByteArray& source_hash,
+                           const ImageParameters& params,
+                           Length bleed_edge,
+                           std::string_view color_cube,
+                           const fs::path& extension);
+
+    // Replaces output with a link to the stored crop, returns false if there is no such crop or it can't be linked
+    bool Fetch(std::string_view key, const fs::path& output) const;
+
+    // Stores a freshly written output, does nothing if the crop is stored already,
+    // returns false if the output can't be hard linked into the store
+    bool Put(std::string_view key, const fs::path& output) const;
+
+    // Removes stored crops that no output links to anymore, returns the number of removed crops
+    size_t Prune() const;
+
+    // Replaces one output with a hard link to another, falls back to copying on file systems without hard links,
+    // so never use this to link into or out of the store
+    static bool Link(const fs::path& from, const fs::path& to);
+
+  private:
+    // Replaces to with a hard link to from, without falling back to copying
+    static bool HardLink(const fs::path& from, const fs::path& to);
+
+    fs::path m_Dir;
+};
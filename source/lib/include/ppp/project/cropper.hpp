@@ -2,15 +2,19 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 
 #include <QObject>
-#include <QTimer>
 
 #include <ppp/util.hpp>
 
+#include <ppp/project/crop_pipeline.hpp>
+#include <ppp/project/duplicate_index.hpp>
 #include <ppp/project/image_database.hpp>
+#include <ppp/project/metrics.hpp>
 #include <ppp/project/project.hpp>
+#include <ppp/project/work_queue.hpp>
 
 class QThread;
 
@@ -19,11 +23,13 @@ class Cropper : public QObject
     Q_OBJECT
 
   public:
-    Cropper(std::function<const cv::Mat*(std::string_view)> get_color_cube, const Project& project);
+    Cropper(std::function<const ColorCube*(std::string_view)> get_color_cube, const Project& project);
     ~Cropper();
 
     void Start();
 
+    const MetricsRegistry& GetMetrics() const;
+
     void ClearCropWork();
     void ClearPreviewWork();
 
@@ -37,8 +43,6 @@ class Cropper : public QObject
     void CropProgress(float progress);
     void PreviewUpdated(const fs::path& card_name, const ImagePreview& preview);
 
-    void RestartTimers(QPrivateSignal);
-
   public slots:
     void NewProjectOpenedDiff(const Project::ProjectData& data);
     void ImageDirChangedDiff(const fs::path& image_dir, const fs::path& crop_dir, const std::vector<fs::path>& loaded_previews);
@@ -54,63 +58,154 @@ class Cropper : public QObject
     void CardRenamed(const fs::path& old_card_name, const fs::path& new_card_name);
     void CardModified(const fs::path& card_name);
 
+    // Previews for visible cards are generated before any other preview
+    void VisibleCardsChanged(const std::vector<fs::path>& card_names);
+
     void PauseWork();
     void RestartWork();
 
   private:
-    void CropWork();
-    void PreviewWork();
+    void WorkLoop(size_t worker_index);
+
+    // Trigger done once we have been quiet long enough, otherwise return when to check again, if at all
+    std::optional<std::chrono::steady_clock::time_point> CheckCropWorkDone();
+    std::optional<std::chrono::steady_clock::time_point> CheckPreviewWorkDone();
+
+    // Wakes up to the given number of sleeping workers
+    void NotifyWorkers(uint32_t num_new_work);
+
+    // Names of all cards that workers are currently cropping or previewing
+    std::vector<fs::path> GetWorkInFlight();
 
     void PushWork(const fs::path& card_name, bool needs_crop, bool needs_preview);
     void RemoveWork(const fs::path& card_name);
 
+    // Marks work as no longer being processed, requeueing it if it was pushed again in the meantime
+    void FinishCropWork(const fs::path& card_name);
+    void FinishPreviewWork(const fs::path& card_name);
+
+    // Called when crop work is done, either in a worker or at the end of the crop pipeline
+    void CompleteCropWork(const fs::path& card_name);
+
+    // Failed work is retried after c_RetryDelay, doubled with every attempt, and given up on after c_MaxRetries
+    void RetryCropWork(const fs::path& card_name);
+    void RetryPreviewWork(const fs::path& card_name);
+    // Expects the lock of the queue to be held, returns false if the card was given up on
+    static bool RetryLater(WorkQueue& queue, std::unordered_map<fs::path, uint32_t>& retries, const fs::path& card_name);
+
+    // Hashes all images once the first crop work comes in, unless deduplication is disabled or uncrop is enabled
+    void BuildDuplicates();
+    // Keeps the duplicate index in sync with a card that was added, modified, removed or renamed
+    void UpdateDuplicates(const fs::path& card_name);
+    void WriteDuplicates();
+    void ResetDuplicates();
+
+    // The card that does the crop and preview work for the given card, the card itself unless it is a duplicate
+    fs::path CanonicalCard(const fs::path& card_name);
+    std::vector<fs::path> DuplicateCards(const fs::path& canonical_name);
+    // Content hash of the canonical card if it has any duplicates, empty otherwise
+    QByteArray SharedContentHash(const fs::path& canonical_name);
+    // Opens the source of a card, reusing the hash from the duplicate index if the file didn't change since
+    std::optional<SourceFile> OpenSource(const fs::path& image_dir, const fs::path& card_name);
+    void ClearSharedPreviews();
+
     // These do the actual work, return false when no work to do
     template<class T>
     bool DoCropWork(T* signaller);
     template<class T>
     bool DoPreviewWork(T* signaller);
 
-    std::function<const cv::Mat*(std::string_view)> m_GetColorCube;
+    std::function<const ColorCube*(std::string_view)> m_GetColorCube;
 
-    std::shared_mutex m_ImageDBMutex;
     ImageDataBase m_ImageDB;
 
     std::mutex m_PendingCropWorkMutex;
-    std::vector<fs::path> m_PendingCropWork;
+    WorkQueue m_PendingCropWork;
+    std::unordered_set<fs::path> m_CropWorkInFlight;
+    std::unordered_set<fs::path> m_DeferredCropWork;
+    std::unordered_map<fs::path, uint32_t> m_CropRetries;
     std::atomic_uint32_t m_TotalWorkDone{};
+    std::unique_ptr<CropPipeline> m_CropPipeline;
+
+    // Bumped whenever crop parameters change, crop jobs started on an older generation abort early
+    std::atomic_uint64_t m_CropGeneration{ 0 };
 
     std::mutex m_PendingPreviewWorkMutex;
-    std::vector<fs::path> m_PendingPreviewWork;
+    WorkQueue m_PendingPreviewWork;
+    std::unordered_set<fs::path> m_PreviewWorkInFlight;
+    std::unordered_set<fs::path> m_DeferredPreviewWork;
+    std::unordered_map<fs::path, uint32_t> m_PreviewRetries;
+    std::unordered_set<fs::path> m_VisibleCards;
 
     std::shared_mutex m_PropertyMutex;
     Project::ProjectData m_Data;
     Config m_Cfg;
     std::vector<fs::path> m_LoadedPreviews;
 
+    // Not built while deduplication is disabled or uncrop is enabled
+    std::shared_mutex m_DuplicatesMutex;
+    std::optional<DuplicateIndex> m_Duplicates;
+    fs::path m_DuplicatesImageDir;
+    fs::path m_DuplicatesPath;
+
+    // Previews by canonical card, reused by all duplicates while the canonical content is unchanged
+    struct SharedPreview
+    {
+        QByteArray m_ContentHash;
+        ImagePreview m_Preview;
+    };
+    std::mutex m_SharedPreviewsMutex;
+    std::unordered_map<fs::path, SharedPreview> m_SharedPreviews;
+
+    // Lets crop, preview and uncrop work share a single decode of each source
+    DecodedImageCache m_ImageCache;
+
+    // Set when the crop folder can't hard link into the crop store, which turns the store off until the crop folder changes
+    std::atomic_bool m_CropStoreUnsupported{ false };
+
+    // Reset whenever cropping starts and, if enabled, dumped to c_MetricsFile in the crop folder when it is done
+    MetricsRegistry m_Metrics;
+    static inline constexpr std::string_view c_MetricsFile{ ".cropper_metrics.json" };
+
     std::shared_mutex m_IgnoreMutex;
     std::vector<fs::path> m_IgnoreNotification;
 
-    using time_point = decltype(std::chrono::high_resolution_clock::now());
-    time_point m_CropWorkStartPoint;
+    using time_point = decltype(std::chrono::steady_clock::now());
+    std::atomic<time_point> m_CropWorkStartPoint{};
 
-    class CropperSignalRouter* m_Router;
-
-    // We give the cropper a few updates before triggering done
+    // We wait for the cropper to be quiet for a short while before triggering done
     // so we don't ping-pong start<->done when we work fast
-    static inline constexpr uint32_t c_UpdatesBeforeDoneTrigger{ 6 };
+    static inline constexpr std::chrono::milliseconds c_QuiescenceBeforeDoneTrigger{ 30 };
 
-    QThread* m_CropThread;
-    std::atomic_uint32_t m_CropDone{ 0 };
+    static inline constexpr std::chrono::milliseconds c_RetryDelay{ 250 };
+    static inline constexpr uint32_t c_MaxRetries{ 3 };
 
-    QThread* m_PreviewThread;
-    std::atomic_uint32_t m_PreviewDone{ 0 };
+    // While pausing we report which work is still running in this interval
+    static inline constexpr std::chrono::milliseconds c_PauseReportInterval{ 500 };
 
-    std::atomic_bool m_Pause{ false };
-    std::atomic_uint32_t m_ThreadsPaused{ 0 };
+    std::atomic_bool m_CropWorking{ false };
+    std::atomic<time_point> m_LastCropWorkPoint{};
+    std::atomic_uint32_t m_CropsInFlight{ 0 };
 
+    std::atomic_bool m_PreviewWorking{ false };
+    std::atomic<time_point> m_LastPreviewWorkPoint{};
+    std::atomic_uint32_t m_PreviewsInFlight{ 0 };
+
+    // Workers sleep on this until work is pushed, the cropper is paused or quits
+    std::mutex m_WorkMutex;
+    std::condition_variable m_WorkAvailable;
+    uint64_t m_WorkEpoch{ 0 };
+
+    // Workers notify this when they enter the paused state, guarded by m_WorkMutex
+    std::condition_variable m_WorkerPaused;
+    uint32_t m_ThreadsPaused{ 0 };
+
+    std::atomic_bool m_Pause{ false };
     std::atomic_bool m_Quit{ false };
-    std::atomic_uint32_t m_ThreadsDone{ 0 };
 
-    QTimer* m_CropTimer;
-    QTimer* m_PreviewTimer;
+    // The cropper itself lives on this thread to handle incoming slots
+    QThread* m_CropperThread;
+
+    // Each worker prefers either crop or preview work, but steals from the other queue when idle
+    std::vector<QThread*> m_WorkerThreads;
 };
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <ppp/image.hpp>
+#include <ppp/source_file.hpp>
+#include <ppp/util.hpp>
+
+// A memory-budgeted LRU cache of decoded source images, entries are keyed by path
+// and invalidated when the file's modification time changes
+class DecodedImageCache
+{
+  public:
+    DecodedImageCache(size_t budget_bytes);
+
+    // Returns the decoded image, only decoding it if it is not cached or outdated,
+    // the returned image shares memory with the cache and must not be modified in place
+    Image Read(const fs::path& path);
+    // Same as above, but on a miss the image is decoded from the bytes of the source file, which
+    // are then only read from disk if nobody read them before
+    Image Read(SourceFile& source);
+    // Returns the decoded image only if it is cached and up to date, never decodes and does not count a miss
+    Image Find(const fs::path& path);
+
+    void Erase(const fs::path& path);
+    void Clear();
+
+    void SetBudget(size_t budget_bytes);
+
+    struct Stats
+    {
+        uint64_t m_Hits;
+        uint64_t m_Misses;
+        size_t m_Entries;
+        size_t m_Bytes;
+    };
+    // Hit and miss counts are reset by this call
+    Stats TakeStats();
+
+  private:
+    Image Read(const fs::path& path, SourceFile* source);
+
+    void EvictToBudget();
+
+    struct Entry
+    {
+        fs::path m_Path;
+        fs::file_time_type m_WriteTime;
+        cv::Mat m_Image;
+        size_t m_Bytes;
+    };
+
+    std::mutex m_Mutex;
+    size_t m_BudgetBytes;
+    size_t m_Bytes{ 0 };
+
+    // Most recently used in front
+    std::list<Entry> m_Entries;
+    std::unordered_map<fs::path, std::list<Entry>::iterator> m_Index;
+
+    std::atomic_uint64_t m_Hits{ 0 };
+    std::atomic_uint64_t m_Misses{ 0 };
+};
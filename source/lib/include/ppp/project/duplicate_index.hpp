@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <QByteArray>
+
+#include <ppp/file_hash.hpp>
+#include <ppp/util.hpp>
+
+struct DuplicateIndexEntry
+{
+    FileStat m_Stat;
+
+    QByteArray m_ContentHash;
+    uint64_t m_PerceptualHash{ 0 };
+    int32_t m_Width{ 0 };
+    int32_t m_Height{ 0 };
+};
+
+// Content and perceptual hashes of all images in a folder, used to group identical images
+// so cropping, previewing and embedding them is only done once for the canonical image of
+// each group, that is the image with the shortest name in the group, so originals win over their copies
+//
+// Persisted next to the crops, rebuilding only hashes images that are new or changed
+class DuplicateIndex
+{
+  public:
+    struct Report
+    {
+        size_t m_Images{ 0 };
+        size_t m_Hashed{ 0 };
+        // Number of groups with more than one image and the images in them that don't need any work
+        size_t m_Groups{ 0 };
+        size_t m_Duplicates{ 0 };
+        uintmax_t m_DuplicateBytes{ 0 };
+        std::chrono::milliseconds m_Duration{ 0 };
+    };
+
+    // Hashes all new or changed images in image_dir in parallel, reusing whatever the index at path already knows,
+    // near duplicates are images of the same size whose perceptual hashes are within c_NearDuplicateDistance
+    static DuplicateIndex Build(const fs::path& image_dir, const fs::path& path, bool near_duplicates);
+    // Only loads the persisted index, nothing is hashed
+    static DuplicateIndex Read(const fs::path& path);
+    void Write(const fs::path& path) const;
+
+    // Rehashes a single image after it was added or modified, or forgets it if it no longer exists
+    void Update(const fs::path& image_dir, const fs::path& image_name);
+    // Same as above, split so the image can be hashed without holding on to the index
+    static std::optional<DuplicateIndexEntry> Hash(const fs::path& image_dir, const fs::path& image_name);
+    void Update(const fs::path& image_name, std::optional<DuplicateIndexEntry> entry);
+
+    // The image that does the work for the given one, the image itself if it is not a duplicate
+    const fs::path& Canonical(const fs::path& image_name) const;
+    // All images that are duplicates of the given canonical image, not including the image itself
+    std::vector<fs::path> Duplicates(const fs::path& canonical_name) const;
+    // Hash of the file contents when it was last indexed, empty if the image is not known
+    QByteArray ContentHash(const fs::path& image_name) const;
+    // Same as above, but also empty if the file changed since it was indexed
+    QByteArray ContentHash(const fs::path& image_name, const FileStat& stat) const;
+
+    const Report& GetReport() const;
+
+    static inline constexpr std::string_view c_FileName{ ".duplicates.db" };
+    static inline constexpr uint32_t c_NearDuplicateDistance{ 4 };
+
+  private:
+    void Regroup();
+
+    bool m_NearDuplicates{ false };
+    std::unordered_map<fs::path, DuplicateIndexEntry> m_Entries;
+
+    // Only contains images that are duplicates, mapped to their canonical image
+    std::unordered_map<fs::path, fs::path> m_Canonical;
+
+    Report m_Report{};
+};
@@ -1,7 +1,19 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
 #include <QByteArray>
 
+#include <ppp/file_hash.hpp>
+#include <ppp/mapped_file.hpp>
+#include <ppp/source_file.hpp>
 #include <ppp/util.hpp>
 
 struct ImageParameters
@@ -13,31 +25,137 @@ struct ImageParameters
     bool m_WillWriteOutput{ true };
 };
 
+// The version of a source that some output was made from
+struct SourceVersion
+{
+    QByteArray m_Hash;
+    FileStat m_Stat;
+};
+
 struct ImageDataBaseEntry
 {
     QByteArray m_SourceHash;
+    FileStat m_SourceStat;
     ImageParameters m_Params;
+
+    // Migrated from a database that hashed sources with MD5, the entry still marks the
+    // destination as ours but its hash never matches, so the output is made once more
+    bool m_LegacyHash{ false };
 };
 
+// Persisted as a snapshot plus a journal next to it, every new entry is appended
+// to the journal and the journal is folded back into the snapshot on compaction
+//
+// Journal records are buffered and written in small batches, after c_JournalFlushRecords records,
+// c_JournalFlushInterval after the last write or once cropping is done, whichever comes first,
+// so a crash loses at most the last batch, those crops are redone on the next start
+//
+// The snapshot is a binary hash table of fixed-size records followed by a pool of
+// destination paths, it is mapped read-only and looked up in place, only entries
+// put after loading it are held in memory
+//
+// All functions can be called from any thread, entries put after loading are spread
+// over shards with their own locks so lookups and puts on different destinations
+// don't wait on each other, only writing or swapping the snapshot excludes everything else
 class ImageDataBase
 {
   public:
+    // Maps the snapshot and replays the journal on top of it, new entries will be journaled next to the snapshot,
+    // a snapshot in the older JSON format is migrated to the binary format right away
     static ImageDataBase Read(const fs::path& path);
+
+    ~ImageDataBase();
+
+    ImageDataBase(const ImageDataBase&) = delete;
+    ImageDataBase(ImageDataBase&&) = delete;
+    ImageDataBase& operator=(const ImageDataBase&) = delete;
+    ImageDataBase& operator=(ImageDataBase&&) = delete;
+
+    // Drops all entries and reads the database at path instead, the same way Read does
+    void Reset(const fs::path& path);
+
+    // Writes a full snapshot and empties the journal
     void Write(const fs::path& path);
 
+    // Writes buffered journal records to disk
+    void FlushJournal();
+
+    // Flushes the journal and writes a full snapshot only if the journal has grown large
+    void CompactIfNeeded();
+
     // Checks if the given file is part of the database at all, indicating that
     // we previously touched this file
     bool FindEntry(const fs::path& destination) const;
 
     // Tests if the mapping exists in the database and returns:
-    //  - an empty hash if matches
-    //  - the source hash if it mismatches
-    // Note: Assumes source exists, if it doesn't an empty hash will be returned
-    QByteArray TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params) const;
+    //  - nothing if it matches
+    //  - the current source version if it mismatches
+    // The source is only hashed if its size, modification time or inode changed, if it still
+    // has the same contents the new stat is put into the database so it is not hashed again
+    // Note: Assumes source exists, if it doesn't nothing will be returned
+    std::optional<SourceVersion> TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params);
+    // Same as above, but if the source needs hashing it is read through the given source file,
+    // so the caller can decode the same bytes afterwards without reading the file again
+    std::optional<SourceVersion> TestEntry(const fs::path& destination, SourceFile& source, ImageParameters params);
 
     // Puts the given mapping into the database
-    void PutEntry(const fs::path& destination, QByteArray source_hash, ImageParameters params);
+    void PutEntry(const fs::path& destination, SourceVersion source, ImageParameters params);
 
   private:
-    std::unordered_map<fs::path, ImageDataBaseEntry> m_DataBase;
+    explicit ImageDataBase(const fs::path& path);
+
+    // All of these expect m_SnapshotMutex to be held exclusively
+    void ResetLocked(const fs::path& path);
+    void WriteLocked(const fs::path& path);
+    void ClearOverlay();
+
+    // Expects m_SnapshotMutex to be held, shared is enough
+    void FlushJournalLocked();
+
+    std::optional<ImageDataBaseEntry> GetEntry(const fs::path& destination) const;
+
+    // Returns false if the file is not a valid binary snapshot
+    bool MapSnapshot(const fs::path& path);
+    std::optional<ImageDataBaseEntry> FindSnapshotEntry(const fs::path& destination) const;
+
+    // Returns false if the file is not a valid JSON snapshot, loaded entries end up in the overlay
+    bool ReadJsonSnapshot(const fs::path& path);
+
+    void OpenJournal(const fs::path& path);
+    // Returns true if the journal held any records
+    bool ReplayJournal(const fs::path& path);
+
+    // Held shared by every lookup and put, exclusively while the snapshot is written or swapped
+    mutable std::shared_mutex m_SnapshotMutex;
+    std::optional<MappedFile> m_Snapshot;
+
+    // Entries put since the snapshot was mapped, these take precedence over the snapshot
+    struct OverlayShard
+    {
+        mutable std::shared_mutex m_Mutex;
+        std::unordered_map<fs::path, ImageDataBaseEntry> m_Entries;
+    };
+    static inline constexpr size_t c_OverlayShards{ 32 };
+    std::array<OverlayShard, c_OverlayShards> m_Overlay;
+
+    OverlayShard& GetShard(const fs::path& destination);
+    const OverlayShard& GetShard(const fs::path& destination) const;
+
+    static inline constexpr size_t c_JournalCompactionThreshold{ 4096 };
+
+    fs::path m_Path;
+
+    // Records are buffered under m_JournalMutex, which is only held for appending to the buffer,
+    // and written in batches under m_JournalWriteMutex, so puts don't wait on file I/O
+    static inline constexpr size_t c_JournalFlushSize{ 64 * 1024 };
+    static inline constexpr size_t c_JournalFlushRecords{ 16 };
+    static inline constexpr std::chrono::milliseconds c_JournalFlushInterval{ 100 };
+    std::mutex m_JournalWriteMutex;
+    std::mutex m_JournalMutex;
+    std::ofstream m_Journal;
+    std::string m_JournalBuffer;
+    size_t m_JournalBufferedRecords{ 0 };
+    std::chrono::steady_clock::time_point m_JournalFlushPoint{};
+    size_t m_JournalEntries{ 0 };
+    std::atomic_uint64_t m_PutSequence{ 0 };
 };
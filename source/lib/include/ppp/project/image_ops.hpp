@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include <ppp/color_cube.hpp>
 #include <ppp/image.hpp>
 #include <ppp/util.hpp>
 
@@ -27,6 +28,39 @@ inline const std::array g_ValidImageExtensions{
 std::vector<fs::path> ListImageFiles(const fs::path& path);
 std::vector<fs::path> ListImageFiles(const fs::path& path_one, const fs::path& path_two);
 
+// Describes a crop, resize, color cube, corner rounding and rotation, in that order, that
+// TransformImage applies in a single pass over the output, tile by tile
+struct ImageTransform
+{
+    // Pixels removed from each side of the source
+    Pixel m_CropLeft{ 0_pix };
+    Pixel m_CropTop{ 0_pix };
+    Pixel m_CropRight{ 0_pix };
+    Pixel m_CropBottom{ 0_pix };
+
+    // Size after cropping and resizing, before rotation, zero to keep the cropped size
+    PixelSize m_Size{ 0_pix, 0_pix };
+
+    // No color correction is done when this is null
+    const ColorCube* m_ColorCube{ nullptr };
+
+    // Real size of the card, needed to compute the corner radius in pixels, zero radius keeps corners as they are
+    Size m_CardSize{ 0_mm, 0_mm };
+    Length m_CornerRadius{ 0_mm };
+
+    Image::Rotation m_Rotation{ Image::Rotation::None };
+};
+
+// Samples deeper than 8 bit are scaled down to 8 bit, unless the transform only crops and rotates
+Image TransformImage(const Image& image, const ImageTransform& transform);
+
+// The crop and resize CropImage would do, without doing it
+ImageTransform CropTransform(const Image& image,
+                             const fs::path& image_name,
+                             Size card_size,
+                             Length full_bleed,
+                             Length bleed_edge,
+                             PixelDensity max_density);
 Image CropImage(const Image& image,
                 const fs::path& image_name,
                 Size card_size,
@@ -40,4 +74,10 @@ fs::path GetOutputDir(const fs::path& crop_dir, Length bleed_edge, const std::st
 ImgDict ReadPreviews(const fs::path& img_cache_file);
 void WritePreviews(const fs::path& img_cache_file, const ImgDict& img_dict);
 
-cv::Mat LoadColorCube(const fs::path& file_path);
+// Parses the contents of a .cube file, returns an empty lattice if it is malformed
+ColorCubeLattice ParseColorCube(std::string_view color_cube_raw);
+ColorCubeLattice LoadColorCube(const fs::path& file_path);
+
+// Loads the compiled form of the cube from the cache directory, keyed by the hash of the
+// .cube file, compiling the cube and storing it in the cache if it is not there yet
+ColorCube LoadCompiledColorCube(const fs::path& file_path, const fs::path& cache_dir);
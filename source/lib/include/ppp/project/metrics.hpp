@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Collects named timings, counters and gauges from any thread, can be queried
+// from code or dumped as JSON to see where work is spending its time
+class MetricsRegistry
+{
+  public:
+    MetricsRegistry();
+
+    struct TimingStats
+    {
+        uint64_t m_Count{ 0 };
+        std::chrono::nanoseconds m_Total{ 0 };
+        std::chrono::nanoseconds m_Min{ std::chrono::nanoseconds::max() };
+        std::chrono::nanoseconds m_Max{ 0 };
+    };
+
+    void RecordTiming(std::string_view name, std::chrono::nanoseconds duration);
+    void AddCount(std::string_view name, uint64_t count = 1);
+    void SetGauge(std::string_view name, double value);
+
+    std::optional<TimingStats> GetTiming(std::string_view name) const;
+    uint64_t GetCount(std::string_view name) const;
+    std::optional<double> GetGauge(std::string_view name) const;
+
+    // Counts per second since the last reset
+    double GetThroughput(std::string_view name) const;
+
+    std::string DumpJson() const;
+
+    void Reset();
+
+    // Records the time between construction and destruction
+    class ScopedTimer
+    {
+      public:
+        ScopedTimer(MetricsRegistry& registry, std::string_view name);
+        ~ScopedTimer();
+
+      private:
+        MetricsRegistry& m_Registry;
+        std::string_view m_Name;
+        std::chrono::steady_clock::time_point m_StartPoint;
+    };
+
+  private:
+    mutable std::mutex m_Mutex;
+    std::chrono::steady_clock::time_point m_ResetPoint;
+    std::map<std::string, TimingStats, std::less<>> m_Timings;
+    std::map<std::string, uint64_t, std::less<>> m_Counters;
+    std::map<std::string, double, std::less<>> m_Gauges;
+};
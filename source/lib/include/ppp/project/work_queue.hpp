@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+#include <ppp/util.hpp>
+
+// An insertion-ordered queue of unique paths, all operations are O(1) except for delayed paths,
+// which are kept aside ordered by when they are due and queued at the back once they are
+class WorkQueue
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Returns false if the path was already queued, a delayed path is queued right away
+    bool Push(const fs::path& path);
+    bool PushFront(const fs::path& path);
+    // Queues the path once not_before has passed, returns false if the path was already queued or delayed
+    bool PushDelayed(const fs::path& path, Clock::time_point not_before);
+    // Returns false if the path was neither queued nor delayed
+    bool Remove(const fs::path& path);
+    // Queues all delayed paths that are due at now before popping
+    std::optional<fs::path> Pop(Clock::time_point now = Clock::now());
+
+    // When the next delayed path is due, nothing if no path is delayed
+    std::optional<Clock::time_point> NextDelayed() const;
+
+    // Moves all given paths that are queued to the front, keeping their relative order,
+    // everything else keeps its order behind them
+    void MoveToFront(std::span<const fs::path> paths);
+
+    // Queued or delayed
+    bool Contains(const fs::path& path) const;
+
+    // Only counts queued paths, not delayed ones
+    size_t Size() const;
+    bool Empty() const;
+
+    void Clear();
+
+  private:
+    std::list<fs::path> m_Queue;
+    std::unordered_map<fs::path, std::list<fs::path>::iterator> m_Index;
+
+    std::multimap<Clock::time_point, fs::path> m_Delayed;
+    std::unordered_map<fs::path, std::multimap<Clock::time_point, fs::path>::iterator> m_DelayedIndex;
+};
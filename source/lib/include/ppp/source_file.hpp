@@ -0,0 +1,48 @@
+#pragma once
+
+#include <optional>
+
+#include <QByteArray>
+
+#include <ppp/file_hash.hpp>
+#include <ppp/image.hpp>
+#include <ppp/util.hpp>
+
+// A source image that is read from disk at most once, the same bytes are hashed and decoded,
+// nothing is read until either is needed, so an unchanged source is only ever stat'ed
+//
+// Sources are read rather than mapped, users may rewrite them while we read them, which
+// would fault a mapping and on Windows a mapping would keep them from being saved at all
+//
+// Not thread-safe, but can be handed from one thread to the next
+class SourceFile
+{
+  public:
+    // Returns nothing if the file does not exist or can't be queried
+    static std::optional<SourceFile> Open(const fs::path& path);
+
+    const fs::path& Path() const;
+    const FileStat& Stat() const;
+
+    // Reads the whole file into memory on first use, empty if it can't be read
+    EncodedImageView Bytes();
+
+    // Same as HashFile, but computed from Bytes and only once
+    const QByteArray& Hash();
+    // Uses a hash of this version of the file that was computed elsewhere, so it isn't read just for hashing
+    void SetHash(QByteArray hash);
+
+    // Same as Image::Read, but decoded from Bytes
+    Image Decode();
+
+  private:
+    SourceFile() = default;
+
+    fs::path m_Path;
+    FileStat m_Stat;
+
+    bool m_Loaded{ false };
+    EncodedImage m_Bytes;
+
+    std::optional<QByteArray> m_Hash;
+};
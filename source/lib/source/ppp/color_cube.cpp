@@ -0,0 +1,429 @@
+#include <ppp/color_cube.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace
+{
+inline constexpr std::align_val_t c_NodeAlignment{ 64 };
+
+inline constexpr std::array<char, 8> c_CompiledMagic{ 'P', 'P', 'P', 'C', 'U', 'B', 'E', '\0' };
+inline constexpr uint32_t c_CompiledVersion{ 1 };
+// Nodes start at this offset, so they stay cache-aligned when the file is mapped
+inline constexpr size_t c_CompiledHeaderSize{ 64 };
+
+struct CompiledHeader
+{
+    std::array<char, 8> m_Magic;
+    uint32_t m_Version;
+    int32_t m_LatticeSize;
+    std::array<float, 3> m_DomainMin;
+    std::array<float, 3> m_DomainMax;
+};
+static_assert(sizeof(CompiledHeader) <= c_CompiledHeaderSize);
+
+size_t NumNodes(int lattice_size)
+{
+    const size_t padded_size{ static_cast<size_t>(lattice_size) + 1 };
+    return padded_size * padded_size * padded_size;
+}
+
+// Weights are in [0, 256), so each of the three interpolation steps adds 8 bits and
+// the result of the last step fits into 32 bits with the channel value in the top 8 bits
+inline constexpr uint32_t c_WeightOne{ 256 };
+inline constexpr int c_ResultShift{ 24 };
+
+// Offsets of the eight corners relative to the (r_lo, g_lo, b_lo) node, in interpolation order
+std::array<int32_t, 8> CornerOffsets(int padded_size)
+{
+    const int32_t r_step{ padded_size * padded_size };
+    const int32_t g_step{ padded_size };
+    const int32_t b_step{ 1 };
+    return {
+        0,
+        r_step,
+        g_step,
+        r_step + g_step,
+        b_step,
+        r_step + b_step,
+        g_step + b_step,
+        r_step + g_step + b_step,
+    };
+}
+
+template<int Channels>
+void ApplyScalar(const uint32_t* nodes,
+                 const std::array<std::array<int32_t, 256>, 3>& offsets,
+                 const std::array<std::array<uint32_t, 256>, 3>& weights,
+                 const std::array<int32_t, 8>& corner_offsets,
+                 const uchar* src,
+                 uchar* dst,
+                 int begin,
+                 int end)
+{
+    static constexpr auto c_LinearInterpolate{
+        [](uint32_t lhs, uint32_t rhs, uint32_t weight)
+        {
+            return lhs * (c_WeightOne - weight) + rhs * weight;
+        },
+    };
+
+    for (int x = begin; x < end; x++)
+    {
+        const uchar* col{ src + x * Channels };
+        uchar* out_element{ dst + x * Channels };
+        if constexpr (Channels == 4)
+        {
+            out_element[3] = col[3];
+        }
+
+        const uchar r{ col[2] };
+        const uchar g{ col[1] };
+        const uchar b{ col[0] };
+        const uint32_t* base{ nodes + offsets[0][r] + offsets[1][g] + offsets[2][b] };
+
+#ifdef NDEBUG
+        // In Release we interpolate between the eight cube-elements
+        const uint32_t r_weight{ weights[0][r] };
+        const uint32_t g_weight{ weights[1][g] };
+        const uint32_t b_weight{ weights[2][b] };
+
+        std::array<uint32_t, 8> corners;
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            corners[i] = base[corner_offsets[i]];
+        }
+
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            const auto channel{
+                [&](size_t i)
+                {
+                    return (corners[i] >> (8 * c)) & 0xff;
+                }
+            };
+            const uint32_t x00{ c_LinearInterpolate(channel(0), channel(1), r_weight) };
+            const uint32_t x10{ c_LinearInterpolate(channel(2), channel(3), r_weight) };
+            const uint32_t x01{ c_LinearInterpolate(channel(4), channel(5), r_weight) };
+            const uint32_t x11{ c_LinearInterpolate(channel(6), channel(7), r_weight) };
+            const uint32_t y0{ c_LinearInterpolate(x00, x10, g_weight) };
+            const uint32_t y1{ c_LinearInterpolate(x01, x11, g_weight) };
+            out_element[c] = static_cast<uchar>(c_LinearInterpolate(y0, y1, b_weight) >> c_ResultShift);
+        }
+#else
+        // In Debug we just get the nearest element
+        (void)weights;
+        (void)corner_offsets;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            out_element[c] = static_cast<uchar>((*base >> (8 * c)) & 0xff);
+        }
+#endif
+    }
+}
+
+#if defined(NDEBUG) && CV_SIMD
+// Processes as many pixels as fit into one 8-bit vector, returns the first pixel that was not processed
+template<int Channels>
+int ApplySimd(const uint32_t* nodes,
+              const std::array<std::array<int32_t, 256>, 3>& offsets,
+              const std::array<std::array<uint32_t, 256>, 3>& weights,
+              const std::array<int32_t, 8>& corner_offsets,
+              const uchar* src,
+              uchar* dst,
+              int width)
+{
+    const int num_lanes{ cv::VTraits<cv::v_uint8>::vlanes() };
+    const cv::v_uint32 weight_one{ cv::vx_setall_u32(c_WeightOne) };
+    const cv::v_uint32 channel_mask{ cv::vx_setall_u32(0xff) };
+
+    const auto linear_interpolate{
+        [&](const cv::v_uint32& lhs, const cv::v_uint32& rhs, const cv::v_uint32& weight)
+        {
+            return cv::v_add(cv::v_mul(lhs, cv::v_sub(weight_one, weight)), cv::v_mul(rhs, weight));
+        }
+    };
+
+    // Widens 8-bit channel values into four vectors of 32-bit table indices
+    const auto expand{
+        [](const cv::v_uint8& values, std::array<cv::v_int32, 4>& out)
+        {
+            cv::v_uint16 lo, hi;
+            cv::v_expand(values, lo, hi);
+
+            cv::v_uint32 a, b, c, d;
+            cv::v_expand(lo, a, b);
+            cv::v_expand(hi, c, d);
+            out = { cv::v_reinterpret_as_s32(a),
+                    cv::v_reinterpret_as_s32(b),
+                    cv::v_reinterpret_as_s32(c),
+                    cv::v_reinterpret_as_s32(d) };
+        }
+    };
+
+    int x{ 0 };
+    for (; x <= width - num_lanes; x += num_lanes)
+    {
+        cv::v_uint8 b8, g8, r8, a8;
+        if constexpr (Channels == 3)
+        {
+            cv::v_load_deinterleave(src + x * Channels, b8, g8, r8);
+        }
+        else
+        {
+            cv::v_load_deinterleave(src + x * Channels, b8, g8, r8, a8);
+        }
+
+        std::array<cv::v_int32, 4> r32, g32, b32;
+        expand(r8, r32);
+        expand(g8, g32);
+        expand(b8, b32);
+
+        std::array<std::array<cv::v_uint32, 4>, 3> out32;
+        for (size_t i = 0; i < 4; i++)
+        {
+            const cv::v_uint32 r_weight{ cv::v_lut(weights[0].data(), r32[i]) };
+            const cv::v_uint32 g_weight{ cv::v_lut(weights[1].data(), g32[i]) };
+            const cv::v_uint32 b_weight{ cv::v_lut(weights[2].data(), b32[i]) };
+
+            const cv::v_int32 base{
+                cv::v_add(cv::v_add(cv::v_lut(offsets[0].data(), r32[i]),
+                                    cv::v_lut(offsets[1].data(), g32[i])),
+                          cv::v_lut(offsets[2].data(), b32[i])),
+            };
+
+            // Fetch all eight corners once and split them into their channels
+            std::array<std::array<cv::v_uint32, 8>, 3> corners;
+            for (size_t k = 0; k < 8; k++)
+            {
+                const cv::v_uint32 node{ cv::v_lut(nodes, cv::v_add(base, cv::vx_setall_s32(corner_offsets[k]))) };
+                corners[0][k] = cv::v_and(node, channel_mask);
+                corners[1][k] = cv::v_and(cv::v_shr<8>(node), channel_mask);
+                corners[2][k] = cv::v_shr<16>(node);
+            }
+
+            for (size_t c = 0; c < 3; c++)
+            {
+                const auto& corner{ corners[c] };
+                const cv::v_uint32 x00{ linear_interpolate(corner[0], corner[1], r_weight) };
+                const cv::v_uint32 x10{ linear_interpolate(corner[2], corner[3], r_weight) };
+                const cv::v_uint32 x01{ linear_interpolate(corner[4], corner[5], r_weight) };
+                const cv::v_uint32 x11{ linear_interpolate(corner[6], corner[7], r_weight) };
+                const cv::v_uint32 y0{ linear_interpolate(x00, x10, g_weight) };
+                const cv::v_uint32 y1{ linear_interpolate(x01, x11, g_weight) };
+                out32[c][i] = cv::v_shr<c_ResultShift>(linear_interpolate(y0, y1, b_weight));
+            }
+        }
+
+        std::array<cv::v_uint8, 3> out8;
+        for (size_t c = 0; c < 3; c++)
+        {
+            out8[c] = cv::v_pack(cv::v_pack(out32[c][0], out32[c][1]),
+                                 cv::v_pack(out32[c][2], out32[c][3]));
+        }
+
+        if constexpr (Channels == 3)
+        {
+            cv::v_store_interleave(dst + x * Channels, out8[0], out8[1], out8[2]);
+        }
+        else
+        {
+            cv::v_store_interleave(dst + x * Channels, out8[0], out8[1], out8[2], a8);
+        }
+    }
+    return x;
+}
+#endif
+
+template<int Channels>
+void ApplyImpl(const uint32_t* nodes,
+               const std::array<std::array<int32_t, 256>, 3>& offsets,
+               const std::array<std::array<uint32_t, 256>, 3>& weights,
+               const std::array<int32_t, 8>& corner_offsets,
+               const cv::Mat& input,
+               cv::Mat& output)
+{
+    // Rows are independent, so split them between threads and walk each one front to back
+    cv::parallel_for_(
+        cv::Range{ 0, input.rows },
+        [&](const cv::Range& rows)
+        {
+            for (int y = rows.start; y < rows.end; y++)
+            {
+                const uchar* src{ input.ptr<uchar>(y) };
+                uchar* dst{ output.ptr<uchar>(y) };
+
+                int x{ 0 };
+#if defined(NDEBUG) && CV_SIMD
+                x = ApplySimd<Channels>(nodes, offsets, weights, corner_offsets, src, dst, input.cols);
+#endif
+                ApplyScalar<Channels>(nodes, offsets, weights, corner_offsets, src, dst, x, input.cols);
+            }
+        });
+}
+} // namespace
+
+void ColorCube::AlignedDelete::operator()(uint32_t* nodes) const
+{
+    ::operator delete[](nodes, c_NodeAlignment);
+}
+
+ColorCube::ColorCube(const ColorCubeLattice& lattice)
+    : m_LatticeSize{ lattice.m_Lattice.cols }
+    , m_DomainMin{ lattice.m_DomainMin }
+    , m_DomainMax{ lattice.m_DomainMax }
+{
+    if (lattice.m_Lattice.empty() || m_LatticeSize < 2)
+    {
+        m_LatticeSize = 0;
+        return;
+    }
+
+    AllocateNodes();
+
+    const int size{ m_LatticeSize };
+    const int padded_size{ size + 1 };
+    const cv::Vec3b* lattice_data{ lattice.m_Lattice.ptr<cv::Vec3b>() };
+    for (int r = 0; r < padded_size; r++)
+    {
+        for (int g = 0; g < padded_size; g++)
+        {
+            for (int b = 0; b < padded_size; b++)
+            {
+                const int src_r{ std::min(r, size - 1) };
+                const int src_g{ std::min(g, size - 1) };
+                const int src_b{ std::min(b, size - 1) };
+                const cv::Vec3b& node{ lattice_data[(src_r * size + src_g) * size + src_b] };
+                m_Nodes[(static_cast<size_t>(r) * padded_size + g) * padded_size + b] =
+                    static_cast<uint32_t>(node[0]) |
+                    static_cast<uint32_t>(node[1]) << 8 |
+                    static_cast<uint32_t>(node[2]) << 16;
+            }
+        }
+    }
+
+    BuildTables();
+}
+
+ColorCube::operator bool() const
+{
+    return Valid();
+}
+
+bool ColorCube::Valid() const
+{
+    return m_Nodes != nullptr;
+}
+
+int ColorCube::LatticeSize() const
+{
+    return m_LatticeSize;
+}
+
+void ColorCube::Apply(const cv::Mat& input, cv::Mat& output) const
+{
+    if (!Valid())
+    {
+        input.copyTo(output);
+        return;
+    }
+
+    const std::array corner_offsets{ CornerOffsets(m_LatticeSize + 1) };
+    switch (input.channels())
+    {
+    case 3:
+        ApplyImpl<3>(m_Nodes.get(), m_Offsets, m_Weights, corner_offsets, input, output);
+        break;
+    case 4:
+        ApplyImpl<4>(m_Nodes.get(), m_Offsets, m_Weights, corner_offsets, input, output);
+        break;
+    default:
+        break;
+    }
+}
+
+std::vector<std::byte> ColorCube::Serialize() const
+{
+    if (!Valid())
+    {
+        return {};
+    }
+
+    CompiledHeader header{
+        .m_Magic{ c_CompiledMagic },
+        .m_Version = c_CompiledVersion,
+        .m_LatticeSize = m_LatticeSize,
+        .m_DomainMin{ m_DomainMin },
+        .m_DomainMax{ m_DomainMax },
+    };
+
+    const size_t nodes_size{ NumNodes(m_LatticeSize) * sizeof(uint32_t) };
+    std::vector<std::byte> data(c_CompiledHeaderSize + nodes_size);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + c_CompiledHeaderSize, m_Nodes.get(), nodes_size);
+    return data;
+}
+
+ColorCube ColorCube::Deserialize(std::span<const std::byte> data)
+{
+    if (data.size() < c_CompiledHeaderSize)
+    {
+        return {};
+    }
+
+    CompiledHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.m_Magic != c_CompiledMagic ||
+        header.m_Version != c_CompiledVersion ||
+        header.m_LatticeSize < 2 ||
+        data.size() != c_CompiledHeaderSize + NumNodes(header.m_LatticeSize) * sizeof(uint32_t))
+    {
+        return {};
+    }
+
+    ColorCube color_cube{};
+    color_cube.m_LatticeSize = header.m_LatticeSize;
+    color_cube.m_DomainMin = header.m_DomainMin;
+    color_cube.m_DomainMax = header.m_DomainMax;
+    color_cube.AllocateNodes();
+    std::memcpy(color_cube.m_Nodes.get(), data.data() + c_CompiledHeaderSize, data.size() - c_CompiledHeaderSize);
+    color_cube.BuildTables();
+    return color_cube;
+}
+
+void ColorCube::AllocateNodes()
+{
+    const size_t num_nodes{ NumNodes(m_LatticeSize) };
+    m_Nodes.reset(static_cast<uint32_t*>(::operator new[](num_nodes * sizeof(uint32_t), c_NodeAlignment)));
+}
+
+void ColorCube::BuildTables()
+{
+    const int size{ m_LatticeSize };
+    const int padded_size{ size + 1 };
+    const std::array<int32_t, 3> axis_steps{ padded_size * padded_size, padded_size, 1 };
+    for (size_t axis = 0; axis < 3; axis++)
+    {
+        // Lattice axes run in the reverse order of the channels in the file
+        const float domain_min{ m_DomainMin[2 - axis] };
+        const float domain_range{ m_DomainMax[2 - axis] - m_DomainMin[2 - axis] };
+        for (int i = 0; i < 256; i++)
+        {
+            // Same mapping of channel value to lattice position as a floating point evaluation would do,
+            // the upper node is always the next one thanks to the padding
+            const float normalized{ std::clamp((static_cast<float>(i) / 255 - domain_min) / domain_range, 0.0f, 1.0f) };
+            const float v{ normalized * (size - 1) };
+            const int lo{ static_cast<int>(std::floor(v)) };
+            const float frac{ v - static_cast<float>(lo) };
+            const uint32_t weight{ std::min(static_cast<uint32_t>(std::lround(frac * c_WeightOne)), c_WeightOne - 1) };
+
+            m_Offsets[axis][i] = lo * axis_steps[axis];
+            m_Weights[axis][i] = weight;
+        }
+    }
+}
@@ -30,6 +30,26 @@ void Config::SetPdfBackend(PdfBackend backend)
     }
 }
 
+std::array<std::pair<std::string_view, Config::CropStageConfig*>, 4> Config::CropStages()
+{
+    return {
+        std::pair{ "Decode", &m_CropDecodeStage },
+        std::pair{ "Transform", &m_CropTransformStage },
+        std::pair{ "Encode", &m_CropEncodeStage },
+        std::pair{ "Write", &m_CropWriteStage },
+    };
+}
+
+std::array<std::pair<std::string_view, const Config::CropStageConfig*>, 4> Config::CropStages() const
+{
+    return {
+        std::pair{ "Decode", &m_CropDecodeStage },
+        std::pair{ "Transform", &m_CropTransformStage },
+        std::pair{ "Encode", &m_CropEncodeStage },
+        std::pair{ "Write", &m_CropWriteStage },
+    };
+}
+
 Config LoadConfig()
 {
     Config config{};
@@ -206,6 +226,31 @@ Config LoadConfig()
                 }
             }
 
+            config.m_CropperThreads = settings.value("Cropper.Threads", 0).toUInt();
+
+            for (auto [stage_name, stage] : config.CropStages())
+            {
+                const QString key{ QString{ "Cropper.%1." }.arg(ToQString(stage_name)) };
+                stage->m_Threads = settings.value(key + "Threads", stage->m_Threads).toUInt();
+                stage->m_QueueDepth = settings.value(key + "Queue.Depth", stage->m_QueueDepth).toUInt();
+            }
+
+            config.m_CropPngCompression = std::clamp(settings.value("Cropper.Png.Compression", 3).toInt(), 0, 9);
+            {
+                const auto png_strategy{ settings.value("Cropper.Png.Strategy", "Default").toString().toStdString() };
+                config.m_CropPngStrategy = magic_enum::enum_cast<PngStrategy>(png_strategy)
+                                               .value_or(PngStrategy::Default);
+            }
+            config.m_CropPngParallel = settings.value("Cropper.Png.Parallel", true).toBool();
+
+            config.m_DeduplicateCards = settings.value("Cropper.Deduplicate", true).toBool();
+            config.m_DetectNearDuplicates = settings.value("Cropper.Near.Duplicates", false).toBool();
+            config.m_ContentAddressedCrops = settings.value("Cropper.Content.Store", false).toBool();
+
+            config.m_DumpCropperMetrics = settings.value("Cropper.Dump.Metrics", false).toBool();
+
+            config.m_ImageCacheSize = settings.value("Cropper.Image.Cache.Size", 1024).toUInt();
+
             {
                 auto base_unit{ settings.value("Base.Unit") };
                 if (base_unit.isValid())
@@ -372,6 +417,28 @@ void SaveConfig(Config config)
             const auto base_unit_name{ config.m_BaseUnit.m_Name };
             settings.setValue("Base.Unit", ToQString(base_unit_name));
 
+            settings.setValue("Cropper.Threads", config.m_CropperThreads);
+
+            for (auto [stage_name, stage] : config.CropStages())
+            {
+                const QString key{ QString{ "Cropper.%1." }.arg(ToQString(stage_name)) };
+                settings.setValue(key + "Threads", stage->m_Threads);
+                settings.setValue(key + "Queue.Depth", stage->m_QueueDepth);
+            }
+
+            settings.setValue("Cropper.Png.Compression", config.m_CropPngCompression);
+            const std::string_view png_strategy{ magic_enum::enum_name(config.m_CropPngStrategy) };
+            settings.setValue("Cropper.Png.Strategy", ToQString(png_strategy));
+            settings.setValue("Cropper.Png.Parallel", config.m_CropPngParallel);
+
+            settings.setValue("Cropper.Deduplicate", config.m_DeduplicateCards);
+            settings.setValue("Cropper.Near.Duplicates", config.m_DetectNearDuplicates);
+            settings.setValue("Cropper.Content.Store", config.m_ContentAddressedCrops);
+
+            settings.setValue("Cropper.Dump.Metrics", config.m_DumpCropperMetrics);
+
+            settings.setValue("Cropper.Image.Cache.Size", config.m_ImageCacheSize);
+
             settings.endGroup();
         }
 
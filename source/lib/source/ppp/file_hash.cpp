@@ -0,0 +1,124 @@
+#include <ppp/file_hash.hpp>
+
+#include <array>
+#include <memory>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <QFile>
+
+#include <xxhash.h>
+
+#include <ppp/qt_util.hpp>
+
+static QByteArray ToByteArray(XXH128_hash_t hash)
+{
+    XXH128_canonical_t canonical;
+    XXH128_canonicalFromHash(&canonical, hash);
+    return QByteArray{
+        reinterpret_cast<const char*>(canonical.digest),
+        static_cast<qsizetype>(sizeof(canonical.digest)),
+    };
+}
+
+std::optional<FileStat> StatFile(const fs::path& path)
+{
+#ifdef _WIN32
+    std::error_code error_code;
+    const uintmax_t file_size{ fs::file_size(path, error_code) };
+    if (error_code)
+    {
+        return std::nullopt;
+    }
+
+    const fs::file_time_type write_time{ fs::last_write_time(path, error_code) };
+    if (error_code)
+    {
+        return std::nullopt;
+    }
+
+    // The file index is the closest thing to an inode, it changes when a file is replaced rather than written to
+    uint64_t file_index{ 0 };
+    const HANDLE file{
+        CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr),
+    };
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        BY_HANDLE_FILE_INFORMATION file_info;
+        if (GetFileInformationByHandle(file, &file_info))
+        {
+            file_index = (uint64_t{ file_info.nFileIndexHigh } << 32) | file_info.nFileIndexLow;
+        }
+        CloseHandle(file);
+    }
+
+    return FileStat{
+        .m_Size = file_size,
+        .m_WriteTime = static_cast<int64_t>(write_time.time_since_epoch().count()),
+        .m_Inode = file_index,
+    };
+#else
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0)
+    {
+        return std::nullopt;
+    }
+
+#ifdef __APPLE__
+    const timespec write_time{ file_stat.st_mtimespec };
+#else
+    const timespec write_time{ file_stat.st_mtim };
+#endif
+
+    return FileStat{
+        .m_Size = static_cast<uintmax_t>(file_stat.st_size),
+        .m_WriteTime = static_cast<int64_t>(write_time.tv_sec) * 1'000'000'000 + write_time.tv_nsec,
+        .m_Inode = static_cast<uint64_t>(file_stat.st_ino),
+    };
+#endif
+}
+
+QByteArray HashBytes(std::span<const std::byte> bytes)
+{
+    return ToByteArray(XXH3_128bits(bytes.data(), bytes.size()));
+}
+
+QByteArray HashFile(const fs::path& path)
+{
+    // Stream rather than map, the file may be rewritten while we read it, which would fault a mapping
+    QFile file{ ToQString(path) };
+    if (!file.open(QFile::ReadOnly))
+    {
+        return {};
+    }
+
+    const std::unique_ptr<XXH3_state_t, decltype(&XXH3_freeState)> state{ XXH3_createState(), &XXH3_freeState };
+    if (state == nullptr || XXH3_128bits_reset(state.get()) != XXH_OK)
+    {
+        return {};
+    }
+
+    static constexpr qint64 c_ChunkSize{ 1 << 20 };
+    const auto chunk{ std::make_unique<std::array<char, c_ChunkSize>>() };
+    while (true)
+    {
+        const qint64 read{ file.read(chunk->data(), c_ChunkSize) };
+        if (read < 0)
+        {
+            return {};
+        }
+        if (read == 0)
+        {
+            break;
+        }
+
+        XXH3_128bits_update(state.get(), chunk->data(), static_cast<size_t>(read));
+    }
+
+    return ToByteArray(XXH3_128bits_digest(state.get()));
+}
@@ -1,7 +1,9 @@
 #include <ppp/image.hpp>
 
 #include <bit>
+#include <mutex>
 #include <ranges>
+#include <unordered_map>
 
 #include <dla/scalar_math.h>
 
@@ -9,51 +11,12 @@
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <QImageReader>
 #include <QPixmap>
 
 #include <ppp/color.hpp>
-
-namespace pngcrc
-{
-static uint32_t CRC(const uchar* buf, int len)
-{
-    static constexpr auto c_CrcTable{
-        []()
-        {
-            std::array<uint32_t, 256> crc_table_bld{};
-            for (int32_t n = 0; n < 256; n++)
-            {
-                uint32_t c{ static_cast<uint32_t>(n) };
-                for (int32_t k = 0; k < 8; k++)
-                {
-                    if (c & 1)
-                    {
-                        c = 0xedb88320L ^ (c >> 1);
-                    }
-                    else
-                    {
-                        c = c >> 1;
-                    }
-                }
-                crc_table_bld[n] = c;
-            }
-            return crc_table_bld;
-        }()
-    };
-    static constexpr auto c_CrcImpl{
-        [](uint32_t crc, const uchar* buf, int len)
-        {
-            uint32_t c{ crc };
-            for (int32_t n = 0; n < len; n++)
-            {
-                c = c_CrcTable[(c ^ buf[n]) & 0xff] ^ (c >> 8);
-            }
-            return c;
-        }
-    };
-    return c_CrcImpl(0xffffffffL, buf, len) ^ 0xffffffffL;
-}
-} // namespace pngcrc
+#include <ppp/color_cube.hpp>
+#include <ppp/png_writer.hpp>
 
 Image::Image(cv::Mat impl)
     : m_Impl{ std::move(impl) }
@@ -81,10 +44,15 @@ Image& Image::operator=(Image&& rhs)
 }
 Image& Image::operator=(const Image& rhs)
 {
-    m_Impl = rhs.m_Impl.clone();
+    m_Impl = rhs.m_Impl;
     return *this;
 }
 
+Image Image::Clone() const
+{
+    return Image{ m_Impl.clone() };
+}
+
 Image Image::Read(const fs::path& path)
 {
     Image img{};
@@ -92,6 +60,58 @@ Image Image::Read(const fs::path& path)
     return img;
 }
 
+Image Image::ReadScaled(const fs::path& path, PixelSize target_size)
+{
+    const int target_width{ static_cast<int>(target_size.x.value) };
+    const int target_height{ static_cast<int>(target_size.y.value) };
+
+    // Only reads the header, size is reported before any orientation is applied, same as Read
+    const QSize source_size{ QImageReader{ QString::fromStdString(path.string()) }.size() };
+    if (!source_size.isValid() || target_width <= 0 || target_height <= 0)
+    {
+        return Read(path).Resize(target_size);
+    }
+
+    const fs::path ext{ path.extension() };
+    const bool is_jpeg{ ext == ".jpg" || ext == ".jpeg" };
+
+    Image img{};
+    if (is_jpeg)
+    {
+        // The JPEG decoder scales in the DCT domain, pick the largest reduction that still leaves enough pixels
+        const auto reduced_fits{
+            [&](int factor)
+            {
+                return (source_size.width() + factor - 1) / factor >= target_width &&
+                       (source_size.height() + factor - 1) / factor >= target_height;
+            }
+        };
+        const int read_mode{
+            reduced_fits(8)   ? cv::IMREAD_REDUCED_COLOR_8
+            : reduced_fits(4) ? cv::IMREAD_REDUCED_COLOR_4
+            : reduced_fits(2) ? cv::IMREAD_REDUCED_COLOR_2
+                              : cv::IMREAD_UNCHANGED,
+        };
+        img.m_Impl = cv::imread(path.string().c_str(), read_mode | cv::IMREAD_IGNORE_ORIENTATION);
+    }
+    else
+    {
+        img.m_Impl = cv::imread(path.string().c_str(), cv::IMREAD_UNCHANGED);
+
+        // Halve while that still leaves at least the target size, much cheaper than one large area resize
+        while (img.m_Impl.cols / 2 >= target_width && img.m_Impl.rows / 2 >= target_height)
+        {
+            cv::pyrDown(img.m_Impl, img.m_Impl);
+        }
+    }
+
+    if (img.m_Impl.empty())
+    {
+        return img;
+    }
+    return img.Resize(target_size);
+}
+
 bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality) const
 {
     const fs::path ext{ path.extension() };
@@ -131,85 +151,56 @@ bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression,
 
 bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality, ::Size dimensions) const
 {
-    const fs::path ext{ path.extension() };
-    if (ext == ".png")
+    if (path.extension() == ".png")
     {
-        std::vector<int> png_params;
-        if (png_compression.has_value())
-        {
-            png_params = {
-                cv::IMWRITE_PNG_COMPRESSION,
-                png_compression.value(),
-                cv::IMWRITE_PNG_STRATEGY,
-                cv::IMWRITE_PNG_STRATEGY_DEFAULT,
-            };
-        }
-
-        const PixelDensity density{ Density(dimensions) };
+        // No need to hold the whole encoded image in memory, stream it to the file instead
+        return WritePng(path,
+                        m_Impl,
+                        PngWriteOptions{
+                            .m_Compression{ png_compression },
+                            .m_Density{ Density(dimensions) },
+                        });
+    }
 
-        std::vector<uchar> buf;
-        if (cv::imencode(".png", m_Impl, buf, png_params))
-        {
-            // Squeeze in a pHYs chunk that contains dpi
-            {
-                // Find first IDAT section ...
-                size_t idat_idx{};
-                for (size_t j = 0; j < buf.size() - 4; j++)
-                {
-                    if (std::string_view{ reinterpret_cast<std::string_view::value_type*>(&buf[j]), 4 } == "IDAT")
-                    {
-                        idat_idx = j - 4;
-                        break;
-                    }
-                }
+    const EncodedImage buffer{ Encode(path.extension(), png_compression, jpg_quality, dimensions) };
+    if (buffer.empty())
+    {
+        return false;
+    }
 
-                // Create pHYs chunk...
-                struct
-                {
-                    uint32_t m_Size;
-                    std::array<char, 4> m_Name;
-                    uint32_t m_DotsPerMeterX;
-                    uint32_t m_DotsPerMeterY;
-                    uint8_t m_Unit;
-                } const phys_chunk{
-                    std::byteswap(9u),
-                    { 'p', 'H', 'Y', 's' },
-                    std::byteswap(static_cast<uint32_t>(density.value)),
-                    std::byteswap(static_cast<uint32_t>(density.value)),
-                    1, // this just means meter
-                };
-
-                // size + name + data + padding
-                static constexpr uint32_t c_PhysChunkSize{ 4 + 4 + 9 };
-                // chunk + padding
-                static_assert(sizeof(phys_chunk) == c_PhysChunkSize + 3);
-                // verify padding is at the end ...
-                static_assert(offsetof(decltype(phys_chunk), m_Unit) == c_PhysChunkSize - 1);
-
-                // only the name and data
-                const auto* crc_data{ reinterpret_cast<const uchar*>(&phys_chunk) + 4 };
-                const auto crc_data_size{ c_PhysChunkSize - 4 };
-                const uint32_t crc{ std::byteswap(pngcrc::CRC(crc_data, crc_data_size)) };
-
-                // chunk + crc
-                std::array<uchar, c_PhysChunkSize + 4> phys_buf;
-                std::memcpy(phys_buf.data(), &phys_chunk, c_PhysChunkSize);
-                std::memcpy(phys_buf.data() + c_PhysChunkSize, &crc, 4);
-                buf.insert(buf.begin() + idat_idx, phys_buf.begin(), phys_buf.end());
-            }
+    return WriteEncoded(path, buffer);
+}
 
-            if (FILE * file{ fopen(path.string().c_str(), "wb") })
-            {
-                fwrite(buf.data(), 1, buf.size(), file);
-                fclose(file);
-            }
+bool Image::WriteEncoded(const fs::path& path, EncodedImageView buffer)
+{
+    if (FILE * file{ fopen(path.string().c_str(), "wb") })
+    {
+        const size_t written{ fwrite(buffer.data(), 1, buffer.size(), file) };
+        fclose(file);
+        return written == buffer.size();
+    }
 
-            cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+    return false;
+}
 
-            return true;
+EncodedImage Image::Encode(const fs::path& ext, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality, ::Size dimensions) const
+{
+    const auto to_encoded_image{
+        [](const std::vector<uchar>& buf)
+        {
+            EncodedImage out_buffer(buf.size(), std::byte{});
+            std::memcpy(out_buffer.data(), buf.data(), buf.size());
+            return out_buffer;
         }
+    };
 
-        return false;
+    if (ext == ".png")
+    {
+        return ::EncodePng(m_Impl,
+                           PngWriteOptions{
+                               .m_Compression{ png_compression },
+                               .m_Density{ Density(dimensions) },
+                           });
     }
     else if (ext == ".jpg" || ext == ".jpeg" || ext == ".jpe")
     {
@@ -244,20 +235,20 @@ bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression,
                 *y_density = *x_density;
             }
 
-            if (FILE * file{ fopen(path.string().c_str(), "wb") })
-            {
-                fwrite(buf.data(), 1, buf.size(), file);
-                fclose(file);
-            }
-
-            return true;
+            return to_encoded_image(buf);
         }
 
-        return false;
+        return {};
     }
     else
     {
-        return cv::imwrite(path.string(), m_Impl);
+        std::vector<uchar> buf;
+        if (cv::imencode(ext.string(), m_Impl, buf))
+        {
+            return to_encoded_image(buf);
+        }
+
+        return {};
     }
 }
 
@@ -277,31 +268,7 @@ Image Image::Decode(EncodedImageView buffer)
 
 EncodedImage Image::EncodePng(std::optional<int32_t> compression) const
 {
-    // Safety check: if image is empty, return empty buffer
-    if (m_Impl.empty())
-    {
-        return {};
-    }
-    
-    std::vector<int> png_params;
-    if (compression.has_value())
-    {
-        png_params = {
-            cv::IMWRITE_PNG_COMPRESSION,
-            compression.value(),
-            cv::IMWRITE_PNG_STRATEGY,
-            cv::IMWRITE_PNG_STRATEGY_DEFAULT,
-        };
-    }
-
-    std::vector<uchar> cv_buffer;
-    if (cv::imencode(".png", m_Impl, cv_buffer, png_params))
-    {
-        EncodedImage out_buffer(cv_buffer.size(), std::byte{});
-        std::memcpy(out_buffer.data(), cv_buffer.data(), cv_buffer.size());
-        return out_buffer;
-    }
-    return {};
+    return ::EncodePng(m_Impl, PngWriteOptions{ .m_Compression{ compression } });
 }
 
 EncodedImage Image::EncodeJpg(std::optional<int32_t> quality) const
@@ -426,185 +393,94 @@ Image Image::RoundCorners(::Size real_size, ::Length corner_radius) const
     }
 
     const auto corner_radius_pixels{ static_cast<int>(dla::math::floor(Density(real_size) * corner_radius) / 1_pix) };
-    if (corner_radius_pixels == 0)
+    if (corner_radius_pixels <= 0)
     {
         return *this;
     }
 
-    cv::Mat mask{ m_Impl.rows, m_Impl.cols, CV_8UC1, cv::Scalar{ 0 } };
+    cv::Mat out_impl;
+    switch (m_Impl.channels())
     {
-        const cv::Point top_left_wide{ 0, corner_radius_pixels };
-        const cv::Point bottom_right_wide{ m_Impl.cols, m_Impl.rows - corner_radius_pixels };
-        const cv::Point top_left_tall{ corner_radius_pixels, 0 };
-        const cv::Point bottom_right_tall{ m_Impl.cols - corner_radius_pixels, m_Impl.rows };
-        const auto draw_rect{
-            [&](const cv::Point& top_left, const cv::Point& bottom_right)
-            {
-                cv::rectangle(mask, top_left, bottom_right, cv::Scalar(255), cv::FILLED);
-            },
-        };
-        draw_rect(top_left_wide, bottom_right_wide);
-        draw_rect(top_left_tall, bottom_right_tall);
-
-        const cv::Point top_left{ corner_radius_pixels, corner_radius_pixels };
-        const cv::Point bottom_left{ m_Impl.cols - 1 - corner_radius_pixels, corner_radius_pixels };
-        const cv::Point bottom_right{ m_Impl.cols - 1 - corner_radius_pixels, m_Impl.rows - 1 - corner_radius_pixels };
-        const cv::Point top_right{ corner_radius_pixels, m_Impl.rows - 1 - corner_radius_pixels };
-        const auto draw_arc{
-            [&](const cv::Point& pos)
-            {
-                cv::circle(mask, pos, corner_radius_pixels, cv::Scalar(255), cv::FILLED, cv::LINE_AA);
-            },
-        };
-        draw_arc(top_left);
-        draw_arc(bottom_left);
-        draw_arc(bottom_right);
-        draw_arc(top_right);
+    case 1:
+        cv::cvtColor(m_Impl, out_impl, cv::COLOR_GRAY2BGRA);
+        break;
+    case 3:
+        cv::cvtColor(m_Impl, out_impl, cv::COLOR_BGR2BGRA);
+        break;
+    default:
+        m_Impl.copyTo(out_impl);
+        break;
     }
 
-    std::vector<cv::Mat> out_channels;
-    cv::split(m_Impl, out_channels);
-    if (out_channels.size() != 4)
+    // Walk the corner bands only, mirroring the stencil so each pixel is visited once even when corners overlap
+    const cv::Mat stencil{ CornerStencil(corner_radius_pixels) };
+    const int rows{ out_impl.rows };
+    const int cols{ out_impl.cols };
+    const auto round_row{
+        [&](int y)
+        {
+            const uchar* stencil_row{ stencil.ptr<uchar>(std::min(y, rows - 1 - y)) };
+            cv::Vec4b* row{ out_impl.ptr<cv::Vec4b>(y) };
+            const auto round_columns{
+                [&](int begin, int end)
+                {
+                    for (int x = begin; x < end; x++)
+                    {
+                        uchar& alpha{ row[x][3] };
+                        alpha = static_cast<uchar>((alpha * stencil_row[std::min(x, cols - 1 - x)] + 127) / 255);
+                    }
+                }
+            };
+            round_columns(0, std::min(corner_radius_pixels, cols));
+            round_columns(std::max(cols - corner_radius_pixels, corner_radius_pixels), cols);
+        }
+    };
+    for (int y = 0; y < std::min(corner_radius_pixels, rows); y++)
     {
-        out_channels.push_back(std::move(mask));
+        round_row(y);
     }
-    else
+    for (int y = std::max(rows - corner_radius_pixels, corner_radius_pixels); y < rows; y++)
     {
-        cv::multiply(mask, out_channels[3], out_channels[3]);
+        round_row(y);
     }
 
-    cv::Mat out_impl;
-    cv::merge(out_channels, out_impl);
     return Image{ out_impl };
 }
 
-template<int Channels>
-struct CubeFilter
+cv::Mat Image::CornerStencil(int radius_pixels)
 {
-    const cv::Mat& m_ColorCube;
-    const cv::Mat& m_InputImg;
-    cv::Mat& m_OutputImg;
-
-    using element_t = std::conditional_t<Channels == 3, cv::Vec3b, cv::Vec4b>;
+    // The stencil only depends on the radius in pixels, so keying by it covers every (radius, density) pair that maps to it
+    static std::mutex s_StencilsMutex;
+    static std::unordered_map<int, cv::Mat> s_Stencils;
+    static constexpr size_t c_MaxStencils{ 64 };
 
-    void operator()(int idx)
+    std::lock_guard lock{ s_StencilsMutex };
+    if (const auto it{ s_Stencils.find(radius_pixels) }; it != s_Stencils.end())
     {
-        const int x{ idx % m_InputImg.rows };
-        const int y{ idx / m_InputImg.rows };
-        const auto& col{ m_InputImg.at<element_t>(x, y) };
-
-        auto& out_element{ m_OutputImg.at<element_t>(x, y) };
-        out_element = col;
-
-        const int cube_size_minus_one{ m_ColorCube.cols - 1 };
-        const float r{ (static_cast<float>(col[2]) / 255) * cube_size_minus_one };
-        const float g{ (static_cast<float>(col[1]) / 255) * cube_size_minus_one };
-        const float b{ (static_cast<float>(col[0]) / 255) * cube_size_minus_one };
-
-#ifdef NDEBUG
-        // In Release we interpolate between the eight cube-elements
-
-        const int r_lo{ static_cast<int>(std::floor(r)) };
-        const int r_hi{ static_cast<int>(std::ceil(r)) };
-        const float r_frac{ r - static_cast<float>(r_lo) };
-
-        const int g_lo{ static_cast<int>(std::floor(g)) };
-        const int g_hi{ static_cast<int>(std::ceil(g)) };
-        const float g_frac{ g - static_cast<float>(g_lo) };
-
-        const int b_lo{ static_cast<int>(std::floor(b)) };
-        const int b_hi{ static_cast<int>(std::ceil(b)) };
-        const float b_frac{ b - static_cast<float>(b_lo) };
-
-        static constexpr auto c_LinearInterpolate{
-            [](std::array<ColorRGB32f, 2> values, float alpha)
-            {
-                return values[0] * (1 - alpha) + values[1] * alpha;
-            },
-        };
-
-        static constexpr auto c_BilinearInterpolate{
-            [](std::array<ColorRGB32f, 4> values, std::array<float, 2> alphas)
-            {
-                const std::array interim_values{
-                    c_LinearInterpolate(std::array{ values[0], values[1] }, alphas[0]),
-                    c_LinearInterpolate(std::array{ values[2], values[3] }, alphas[0]),
-                };
-                return c_LinearInterpolate(interim_values, alphas[1]);
-            },
-        };
-
-        static constexpr auto c_TrilinearInterpolate{
-            [](std::array<ColorRGB32f, 8> values, std::array<float, 3> alphas)
-            {
-                const std::array interim_values{
-                    c_BilinearInterpolate(std::array{ values[0], values[1], values[2], values[3] }, std::array{ alphas[0], alphas[1] }),
-                    c_BilinearInterpolate(std::array{ values[4], values[5], values[6], values[7] }, std::array{ alphas[0], alphas[1] }),
-                };
-                return c_LinearInterpolate(interim_values, alphas[2]);
-            },
-        };
-
-        auto color_at{
-            [&](int r, int g, int b)
-            {
-                const auto v{ m_ColorCube.at<cv::Vec3b>(r, g, b) };
-                return ColorRGB32f{
-                    static_cast<float>(v[0]),
-                    static_cast<float>(v[1]),
-                    static_cast<float>(v[2]),
-                };
-            },
-        };
-
-        std::array corners{
-            color_at(r_lo, g_lo, b_lo),
-            color_at(r_hi, g_lo, b_lo),
-
-            color_at(r_lo, g_hi, b_lo),
-            color_at(r_hi, g_hi, b_lo),
-
-            color_at(r_lo, g_lo, b_hi),
-            color_at(r_hi, g_lo, b_hi),
-
-            color_at(r_lo, g_hi, b_hi),
-            color_at(r_hi, g_hi, b_hi),
-        };
+        return it->second;
+    }
 
-        const ColorRGB32f interpolated{ c_TrilinearInterpolate(corners, { r_frac, g_frac, b_frac }) };
-        out_element[0] = static_cast<uchar>(interpolated.r);
-        out_element[1] = static_cast<uchar>(interpolated.g);
-        out_element[2] = static_cast<uchar>(interpolated.b);
-#else
-        // In Debug we just get the nearest element
-        const auto res{ m_ColorCube.at<cv::Vec3b>((int)r, (int)g, (int)b) };
-        out_element[0] = static_cast<uchar>(res[0]);
-        out_element[1] = static_cast<uchar>(res[1]);
-        out_element[2] = static_cast<uchar>(res[2]);
-#endif
+    if (s_Stencils.size() >= c_MaxStencils)
+    {
+        s_Stencils.clear();
     }
-};
 
-Image Image::ApplyColorCube(const cv::Mat& color_cube) const
+    cv::Mat stencil{ radius_pixels, radius_pixels, CV_8UC1, cv::Scalar{ 0 } };
+    cv::circle(stencil, cv::Point{ radius_pixels, radius_pixels }, radius_pixels, cv::Scalar{ 255 }, cv::FILLED, cv::LINE_AA);
+    s_Stencils.emplace(radius_pixels, stencil);
+    return stencil;
+}
+
+Image Image::ApplyColorCube(const ColorCube& color_cube) const
 {
-    if (m_Impl.channels() == 1)
+    if (m_Impl.channels() != 3 && m_Impl.channels() != 4)
     {
         return *this;
     }
 
-    Image filtered{ *this };
-    auto flat_range{ std::views::iota(0, m_Impl.rows * m_Impl.cols) };
-    switch (m_Impl.channels())
-    {
-    case 3:
-        std::for_each(flat_range.begin(), flat_range.end(), CubeFilter<3>{ color_cube, m_Impl, filtered.m_Impl });
-        break;
-    case 4:
-        std::for_each(flat_range.begin(), flat_range.end(), CubeFilter<4>{ color_cube, m_Impl, filtered.m_Impl });
-        break;
-    default:
-        break;
-    }
+    Image filtered{};
+    filtered.m_Impl.create(m_Impl.size(), m_Impl.type());
+    color_cube.Apply(m_Impl, filtered.m_Impl);
     return filtered;
 }
 
@@ -659,6 +535,12 @@ const cv::Mat& Image::GetUnderlying() const
     return m_Impl;
 }
 
+cv::Mat& Image::GetMutableUnderlying()
+{
+    Detach();
+    return m_Impl;
+}
+
 void Image::DebugDisplay() const
 {
     cv::imshow("Debug Display", m_Impl);
@@ -669,3 +551,12 @@ void Image::Release()
 {
     m_Impl = cv::Mat{};
 }
+
+void Image::Detach()
+{
+    // Views into another image share its reference count, so they are detached as well
+    if (m_Impl.u != nullptr && CV_XADD(&m_Impl.u->refcount, 0) > 1)
+    {
+        m_Impl = m_Impl.clone();
+    }
+}
@@ -0,0 +1,44 @@
+#include <ppp/mapped_file.hpp>
+
+#include <QFile>
+
+#include <ppp/qt_util.hpp>
+
+std::optional<MappedFile> MappedFile::Map(const fs::path& path)
+{
+    MappedFile mapped_file{};
+    mapped_file.m_File = std::make_unique<QFile>(ToQString(path));
+    if (!mapped_file.m_File->open(QFile::ReadOnly))
+    {
+        return std::nullopt;
+    }
+
+    const qint64 file_size{ mapped_file.m_File->size() };
+    if (file_size == 0)
+    {
+        return mapped_file;
+    }
+
+    uchar* mapped{ mapped_file.m_File->map(0, file_size) };
+    if (mapped == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    mapped_file.m_Bytes = std::span<const std::byte>{
+        reinterpret_cast<const std::byte*>(mapped),
+        static_cast<size_t>(file_size),
+    };
+    return mapped_file;
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept = default;
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept = default;
+
+// Closing the file unmaps it
+MappedFile::~MappedFile() = default;
+
+std::span<const std::byte> MappedFile::Bytes() const
+{
+    return m_Bytes;
+}
@@ -1,11 +1,13 @@
 #include <ppp/pdf/generate.hpp>
 
 #include <ranges>
+#include <unordered_set>
 
 #include <dla/scalar_math.h>
 
 #include <ppp/util/log.hpp>
 
+#include <ppp/project/duplicate_index.hpp>
 #include <ppp/project/image_ops.hpp>
 #include <ppp/project/project.hpp>
 
@@ -18,6 +20,24 @@ fs::path GeneratePdf(const Project& project)
 
     const auto output_dir{ GetOutputDir(project.m_Data.m_CropDir, project.m_Data.m_BleedEdge, g_Cfg.m_ColorCube) };
 
+    // Backends embed each path only once, so pointing duplicates at their canonical crop
+    // puts the image into the document a single time no matter how often it is used
+    const DuplicateIndex duplicates{
+        g_Cfg.m_DeduplicateCards
+            ? DuplicateIndex::Read(project.m_Data.m_CropDir / DuplicateIndex::c_FileName)
+            : DuplicateIndex{},
+    };
+    std::unordered_set<fs::path> embedded_images;
+
+    // The index is not maintained while uncropping and may be stale, so only trust it for images that didn't change since
+    const auto is_indexed{
+        [&](const fs::path& image_name)
+        {
+            const std::optional<FileStat> stat{ StatFile(project.m_Data.m_ImageDir / image_name) };
+            return stat.has_value() && !duplicates.ContentHash(image_name, stat.value()).isEmpty();
+        }
+    };
+
     ColorRGB32f guides_color_a{
         static_cast<float>(project.m_Data.m_GuidesColorA.r) / 255.0f,
         static_cast<float>(project.m_Data.m_GuidesColorA.g) / 255.0f,
@@ -78,9 +98,25 @@ fs::path GeneratePdf(const Project& project)
                 Length dy = 0_pts,
                 bool is_backside = false)
             {
-                const auto img_path{ output_dir / image.m_Image };
+                const auto img_path{
+                    [&]()
+                    {
+                        const fs::path& canonical_name{ duplicates.Canonical(image.m_Image) };
+                        if (canonical_name != image.m_Image && is_indexed(image.m_Image) && is_indexed(canonical_name))
+                        {
+                            const fs::path canonical_path{ output_dir / canonical_name };
+                            if (fs::exists(canonical_path))
+                            {
+                                return canonical_path;
+                            }
+                        }
+                        return output_dir / image.m_Image;
+                    }()
+                };
                 if (fs::exists(img_path))
                 {
+                    embedded_images.insert(img_path);
+
                     const auto orig_x{ is_backside ? backside_start_x : start_x };
                     const auto orig_y{ is_backside ? backside_start_y : start_y };
                     const auto real_x{ orig_x + x * (card_width + spacing.x) + dx };
@@ -260,6 +296,10 @@ fs::path GeneratePdf(const Project& project)
         }
     }
 
+    LogInfo("Embedded {} distinct images, {} duplicates known",
+            embedded_images.size(),
+            duplicates.GetReport().m_Duplicates);
+
     return pdf->Write(project.m_Data.m_FileName);
 }
 
@@ -4,6 +4,7 @@
 
 #include <ppp/util/log.hpp>
 
+#include <ppp/project/image_ops.hpp>
 #include <ppp/project/project.hpp>
 
 inline HPDF_REAL ToHaruReal(Length l)
@@ -144,9 +145,12 @@ HPDF_Image HaruPdfImageCache::GetImage(fs::path image_path, Image::Rotation rota
             : 0_mm,
     };
     const Image loaded_image{
-        Image::Read(image_path)
-            .RoundCorners(card_size, corner_radius)
-            .Rotate(rotation)
+        TransformImage(Image::Read(image_path),
+                       ImageTransform{
+                           .m_CardSize{ card_size },
+                           .m_CornerRadius{ corner_radius },
+                           .m_Rotation = rotation,
+                       }),
     };
 
     const auto encoded_image{ encoder(loaded_image) };
@@ -4,6 +4,7 @@
 
 #include <ppp/util/log.hpp>
 
+#include <ppp/project/image_ops.hpp>
 #include <ppp/project/project.hpp>
 
 inline int32_t ToPixels(Length l)
@@ -151,11 +152,16 @@ const cv::Mat& PngImageCache::GetImage(fs::path image_path, int32_t w, int32_t h
             ? m_Project.CardCornerRadius()
             : 0_mm,
     };
+    // Width and height are given after rotation, the transform resizes before rotating
+    const bool swap_axes{ rotation == Image::Rotation::Degree90 || rotation == Image::Rotation::Degree270 };
     const Image loaded_image{
-        Image::Read(image_path)
-            .RoundCorners(card_size, corner_radius)
-            .Rotate(rotation)
-            .Resize({ w * 1_pix, h * 1_pix }),
+        TransformImage(Image::Read(image_path),
+                       ImageTransform{
+                           .m_Size{ (swap_axes ? h : w) * 1_pix, (swap_axes ? w : h) * 1_pix },
+                           .m_CardSize{ card_size },
+                           .m_CornerRadius{ corner_radius },
+                           .m_Rotation = rotation,
+                       }),
     };
 
     const cv::Mat& three_channel_image{ loaded_image.GetUnderlying() };
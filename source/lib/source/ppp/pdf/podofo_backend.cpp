@@ -8,6 +8,7 @@
 
 #include <ppp/util/log.hpp>
 
+#include <ppp/project/image_ops.hpp>
 #include <ppp/project/project.hpp>
 
 inline double ToPoDoFoPoints(Length l)
@@ -188,9 +189,12 @@ PoDoFo::PdfImage* PoDoFoImageCache::GetImage(fs::path image_path, Image::Rotatio
             : 0_mm,
     };
     const Image loaded_image{
-        Image::Read(image_path)
-            .RoundCorners(card_size, corner_radius)
-            .Rotate(rotation)
+        TransformImage(Image::Read(image_path),
+                       ImageTransform{
+                           .m_CardSize{ card_size },
+                           .m_CornerRadius{ corner_radius },
+                           .m_Rotation = rotation,
+                       }),
     };
 
     const auto encoded_image{ encoder(loaded_image) };
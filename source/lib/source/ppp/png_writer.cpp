@@ -0,0 +1,551 @@
+#include <ppp/png_writer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <png.h>
+#include <zlib.h>
+
+namespace
+{
+int ToZlibStrategy(PngStrategy strategy)
+{
+    switch (strategy)
+    {
+    case PngStrategy::Filtered:
+        return Z_FILTERED;
+    case PngStrategy::HuffmanOnly:
+        return Z_HUFFMAN_ONLY;
+    case PngStrategy::Rle:
+        return Z_RLE;
+    case PngStrategy::Default:
+    default:
+        return Z_DEFAULT_STRATEGY;
+    }
+}
+
+int PngBitDepth(const cv::Mat& image)
+{
+    return image.depth() == CV_16U ? 16 : 8;
+}
+
+int PngColorType(const cv::Mat& image)
+{
+    switch (image.channels())
+    {
+    case 1:
+        return PNG_COLOR_TYPE_GRAY;
+    case 3:
+        return PNG_COLOR_TYPE_RGB;
+    default:
+        return PNG_COLOR_TYPE_RGB_ALPHA;
+    }
+}
+
+// Only plain data may live between the setjmp and the end of this function,
+// libpng errors longjmp back into it and skip any destructors
+bool WritePngStream(png_structp png, png_infop info, const cv::Mat& image, const PngWriteOptions& options)
+{
+    if (setjmp(png_jmpbuf(png)))
+    {
+        return false;
+    }
+    png_set_IHDR(png,
+                 info,
+                 static_cast<png_uint_32>(image.cols),
+                 static_cast<png_uint_32>(image.rows),
+                 PngBitDepth(image),
+                 PngColorType(image),
+                 PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT,
+                 PNG_FILTER_TYPE_DEFAULT);
+
+    if (options.m_Compression.has_value())
+    {
+        png_set_compression_level(png, options.m_Compression.value());
+        png_set_compression_strategy(png, ToZlibStrategy(options.m_Strategy));
+    }
+    else
+    {
+        png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+        png_set_compression_level(png, Z_BEST_SPEED);
+        png_set_compression_strategy(png, Z_RLE);
+    }
+
+    if (options.m_Density.has_value())
+    {
+        const auto dots_per_meter{ static_cast<png_uint_32>(options.m_Density.value().value) };
+        png_set_pHYs(png, info, dots_per_meter, dots_per_meter, PNG_RESOLUTION_METER);
+    }
+
+    png_write_info(png, info);
+
+    // Transforms have to be set after the header is written
+    if (image.channels() > 1)
+    {
+        png_set_bgr(png);
+    }
+    if (PngBitDepth(image) == 16 && std::endian::native == std::endian::little)
+    {
+        png_set_swap(png);
+    }
+
+    for (int y = 0; y < image.rows; y++)
+    {
+        png_write_row(png, image.ptr<png_byte>(y));
+    }
+    png_write_end(png, nullptr);
+    return true;
+}
+
+bool CanWritePng(const cv::Mat& image)
+{
+    const bool supported_depth{ image.depth() == CV_8U || image.depth() == CV_16U };
+    const bool supported_channels{ image.channels() == 1 || image.channels() == 3 || image.channels() == 4 };
+    return !image.empty() && supported_depth && supported_channels;
+}
+
+template<class SetupIoFn>
+bool WritePngWith(const cv::Mat& image, const PngWriteOptions& options, SetupIoFn&& setup_io)
+{
+    png_structp png{ png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr) };
+    if (png == nullptr)
+    {
+        return false;
+    }
+
+    png_infop info{ png_create_info_struct(png) };
+    AtScopeExit destroy_png{
+        [&]()
+        {
+            png_destroy_write_struct(&png, &info);
+        }
+    };
+    if (info == nullptr)
+    {
+        return false;
+    }
+
+    setup_io(png);
+    return WritePngStream(png, info, image, options);
+}
+// Raw image data is split into bands of at least this size, small enough to keep all threads
+// busy on a large crop and large enough that restarting the deflate window costs little
+inline constexpr size_t c_ParallelBandBytes{ 256 * 1024 };
+
+bool UseParallelWriter(const cv::Mat& image, const PngWriteOptions& options)
+{
+    return options.m_Parallel && image.total() * image.elemSize() >= 2 * c_ParallelBandBytes;
+}
+
+enum class PngFilter : uint8_t
+{
+    None,
+    Sub,
+    Up,
+    Average,
+    Paeth,
+};
+
+uint8_t PaethPredictor(int a, int b, int c)
+{
+    const int p{ a + b - c };
+    const int pa{ std::abs(p - a) };
+    const int pb{ std::abs(p - b) };
+    const int pc{ std::abs(p - c) };
+    if (pa <= pb && pa <= pc)
+    {
+        return static_cast<uint8_t>(a);
+    }
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+// Writes the filter type followed by the filtered row, prior is all zero for the first row of the image
+template<PngFilter Filter>
+void FilterRow(std::span<const uint8_t> row, std::span<const uint8_t> prior, size_t bpp, uint8_t* out)
+{
+    out[0] = static_cast<uint8_t>(Filter);
+    out++;
+    for (size_t i = 0; i < row.size(); i++)
+    {
+        [[maybe_unused]] const int a{ i >= bpp ? row[i - bpp] : 0 };
+        [[maybe_unused]] const int b{ prior[i] };
+        [[maybe_unused]] const int c{ i >= bpp ? prior[i - bpp] : 0 };
+        if constexpr (Filter == PngFilter::None)
+        {
+            out[i] = row[i];
+        }
+        else if constexpr (Filter == PngFilter::Sub)
+        {
+            out[i] = static_cast<uint8_t>(row[i] - a);
+        }
+        else if constexpr (Filter == PngFilter::Up)
+        {
+            out[i] = static_cast<uint8_t>(row[i] - b);
+        }
+        else if constexpr (Filter == PngFilter::Average)
+        {
+            out[i] = static_cast<uint8_t>(row[i] - (a + b) / 2);
+        }
+        else
+        {
+            out[i] = static_cast<uint8_t>(row[i] - PaethPredictor(a, b, c));
+        }
+    }
+}
+
+// Sum of the filtered bytes taken as signed values, the heuristic libpng uses to pick a filter
+size_t FilterCost(std::span<const uint8_t> filtered)
+{
+    size_t cost{ 0 };
+    for (const uint8_t value : filtered.subspan(1))
+    {
+        cost += static_cast<size_t>(std::abs(static_cast<int8_t>(value)));
+    }
+    return cost;
+}
+
+// Converts a row to PNG sample order, RGB instead of BGR and big-endian 16-bit samples
+void ToPngRow(const cv::Mat& image, int y, std::span<uint8_t> out)
+{
+    cv::Mat out_row{ 1, image.cols, image.type(), out.data() };
+    switch (image.channels())
+    {
+    case 3:
+        cv::cvtColor(image.row(y), out_row, cv::COLOR_BGR2RGB);
+        break;
+    case 4:
+        cv::cvtColor(image.row(y), out_row, cv::COLOR_BGRA2RGBA);
+        break;
+    default:
+        image.row(y).copyTo(out_row);
+        break;
+    }
+
+    if (image.depth() == CV_16U && std::endian::native == std::endian::little)
+    {
+        for (size_t i = 0; i + 1 < out.size(); i += 2)
+        {
+            std::swap(out[i], out[i + 1]);
+        }
+    }
+}
+
+struct DeflatedBand
+{
+    std::vector<std::byte> m_Data;
+    uLong m_Adler;
+    size_t m_RawBytes;
+    bool m_Ok;
+};
+
+// Filters and deflates rows [begin, end) into a raw deflate stream that ends on a byte boundary,
+// so bands can be concatenated, only the last band finishes the stream
+DeflatedBand DeflateBand(const cv::Mat& image, const PngWriteOptions& options, int begin, int end, size_t prefix_bytes)
+{
+    const size_t row_bytes{ image.cols * image.elemSize() };
+    const size_t bpp{ image.elemSize() };
+    const bool last_band{ end == image.rows };
+
+    DeflatedBand band{
+        .m_Data{},
+        .m_Adler = adler32(0, nullptr, 0),
+        .m_RawBytes = (row_bytes + 1) * static_cast<size_t>(end - begin),
+        .m_Ok = false,
+    };
+
+    z_stream stream{};
+    const int level{ options.m_Compression.value_or(Z_BEST_SPEED) };
+    const int strategy{ options.m_Compression.has_value() ? ToZlibStrategy(options.m_Strategy) : Z_RLE };
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+    {
+        return band;
+    }
+    AtScopeExit end_deflate{
+        [&]()
+        {
+            deflateEnd(&stream);
+        }
+    };
+
+    // Room for the whole stream up front, plus the empty block a sync flush emits
+    band.m_Data.resize(prefix_bytes + deflateBound(&stream, static_cast<uLong>(band.m_RawBytes)) + 16);
+    stream.next_out = reinterpret_cast<Bytef*>(band.m_Data.data() + prefix_bytes);
+    stream.avail_out = static_cast<uInt>(band.m_Data.size() - prefix_bytes);
+
+    std::vector<uint8_t> prior(row_bytes, 0);
+    std::vector<uint8_t> row(row_bytes);
+    std::array<std::vector<uint8_t>, 5> candidates;
+    for (auto& candidate : candidates)
+    {
+        candidate.resize(row_bytes + 1);
+    }
+
+    if (begin > 0)
+    {
+        ToPngRow(image, begin - 1, prior);
+    }
+
+    for (int y = begin; y < end; y++)
+    {
+        ToPngRow(image, y, row);
+
+        // Without an explicit level tune for speed like the serial writer, otherwise pick the best filter per row
+        std::span<const uint8_t> filtered;
+        if (!options.m_Compression.has_value())
+        {
+            FilterRow<PngFilter::Sub>(row, prior, bpp, candidates[0].data());
+            filtered = candidates[0];
+        }
+        else
+        {
+            FilterRow<PngFilter::None>(row, prior, bpp, candidates[0].data());
+            FilterRow<PngFilter::Sub>(row, prior, bpp, candidates[1].data());
+            FilterRow<PngFilter::Up>(row, prior, bpp, candidates[2].data());
+            FilterRow<PngFilter::Average>(row, prior, bpp, candidates[3].data());
+            FilterRow<PngFilter::Paeth>(row, prior, bpp, candidates[4].data());
+
+            const auto best{
+                std::ranges::min_element(candidates,
+                                         std::less{},
+                                         [](const std::vector<uint8_t>& candidate)
+                                         {
+                                             return FilterCost(candidate);
+                                         }),
+            };
+            filtered = *best;
+        }
+
+        band.m_Adler = adler32(band.m_Adler, filtered.data(), static_cast<uInt>(filtered.size()));
+
+        stream.next_in = const_cast<Bytef*>(filtered.data());
+        stream.avail_in = static_cast<uInt>(filtered.size());
+        const int flush{ y + 1 < end ? Z_NO_FLUSH : last_band ? Z_FINISH : Z_SYNC_FLUSH };
+        const int result{ deflate(&stream, flush) };
+        if (result == Z_STREAM_ERROR || stream.avail_in != 0)
+        {
+            return band;
+        }
+
+        std::swap(prior, row);
+    }
+
+    band.m_Data.resize(band.m_Data.size() - stream.avail_out);
+    band.m_Ok = true;
+    return band;
+}
+
+template<class WriteFn>
+bool WriteChunk(WriteFn& write, std::string_view type, std::span<const std::byte> data)
+{
+    const auto to_big_endian{
+        [](uint32_t value)
+        {
+            return std::endian::native == std::endian::little ? std::byteswap(value) : value;
+        }
+    };
+
+    const uint32_t length{ to_big_endian(static_cast<uint32_t>(data.size())) };
+    uLong crc{ crc32(0, reinterpret_cast<const Bytef*>(type.data()), static_cast<uInt>(type.size())) };
+    if (!data.empty())
+    {
+        // Passing a null buffer would reset the crc
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size()));
+    }
+    const uint32_t crc_be{ to_big_endian(static_cast<uint32_t>(crc)) };
+
+    return write(std::as_bytes(std::span{ &length, 1 })) &&
+           write(std::as_bytes(std::span{ type })) &&
+           write(data) &&
+           write(std::as_bytes(std::span{ &crc_be, 1 }));
+}
+
+// Writes the PNG container by hand, each band becomes one IDAT chunk, the first band carries
+// the zlib header and the last one the Adler-32 of the whole stream, combined from the bands
+template<class WriteFn>
+bool WritePngParallel(const cv::Mat& image, const PngWriteOptions& options, WriteFn&& write)
+{
+    const size_t row_bytes{ image.cols * image.elemSize() };
+    const int rows_per_band{ std::max(static_cast<int>(c_ParallelBandBytes / row_bytes), 1) };
+    const int num_bands{ (image.rows + rows_per_band - 1) / rows_per_band };
+
+    std::vector<DeflatedBand> bands(num_bands);
+    cv::parallel_for_(cv::Range{ 0, num_bands },
+                      [&](const cv::Range& range)
+                      {
+                          for (int i = range.start; i < range.end; i++)
+                          {
+                              const int begin{ i * rows_per_band };
+                              const int end{ std::min(begin + rows_per_band, image.rows) };
+                              bands[i] = DeflateBand(image, options, begin, end, i == 0 ? 2 : 0);
+                          }
+                      });
+    if (!std::ranges::all_of(bands, &DeflatedBand::m_Ok))
+    {
+        return false;
+    }
+
+    // zlib header: deflate with a 32K window, level hint as zlib would write it, check bits
+    const int level{ options.m_Compression.value_or(Z_BEST_SPEED) };
+    const uint8_t cmf{ 0x78 };
+    const uint8_t level_hint{ static_cast<uint8_t>(level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) };
+    uint8_t flg{ static_cast<uint8_t>(level_hint << 6) };
+    flg = static_cast<uint8_t>(flg + 31 - (cmf * 256 + flg) % 31);
+    bands.front().m_Data[0] = std::byte{ cmf };
+    bands.front().m_Data[1] = std::byte{ flg };
+
+    uLong adler{ bands.front().m_Adler };
+    for (const DeflatedBand& band : bands | std::views::drop(1))
+    {
+        adler = adler32_combine(adler, band.m_Adler, static_cast<z_off_t>(band.m_RawBytes));
+    }
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        bands.back().m_Data.push_back(std::byte{ static_cast<uint8_t>(adler >> shift) });
+    }
+
+    const auto to_big_endian_bytes{
+        [](uint32_t value)
+        {
+            return std::array{
+                std::byte{ static_cast<uint8_t>(value >> 24) },
+                std::byte{ static_cast<uint8_t>(value >> 16) },
+                std::byte{ static_cast<uint8_t>(value >> 8) },
+                std::byte{ static_cast<uint8_t>(value) },
+            };
+        }
+    };
+
+    static constexpr std::array<uint8_t, 8> c_Signature{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (!write(std::as_bytes(std::span{ c_Signature })))
+    {
+        return false;
+    }
+
+    {
+        const auto width{ to_big_endian_bytes(static_cast<uint32_t>(image.cols)) };
+        const auto height{ to_big_endian_bytes(static_cast<uint32_t>(image.rows)) };
+
+        std::array<std::byte, 13> ihdr{};
+        std::ranges::copy(width, ihdr.begin());
+        std::ranges::copy(height, ihdr.begin() + 4);
+        ihdr[8] = std::byte{ static_cast<uint8_t>(PngBitDepth(image)) };
+        ihdr[9] = std::byte{ static_cast<uint8_t>(PngColorType(image)) };
+        // Compression, filter and interlace method all zero
+        if (!WriteChunk(write, "IHDR", ihdr))
+        {
+            return false;
+        }
+    }
+
+    if (options.m_Density.has_value())
+    {
+        const auto dots_per_meter{ to_big_endian_bytes(static_cast<uint32_t>(options.m_Density.value().value)) };
+
+        std::array<std::byte, 9> phys{};
+        std::ranges::copy(dots_per_meter, phys.begin());
+        std::ranges::copy(dots_per_meter, phys.begin() + 4);
+        phys[8] = std::byte{ PNG_RESOLUTION_METER };
+        if (!WriteChunk(write, "pHYs", phys))
+        {
+            return false;
+        }
+    }
+
+    for (const DeflatedBand& band : bands)
+    {
+        if (!WriteChunk(write, "IDAT", band.m_Data))
+        {
+            return false;
+        }
+    }
+
+    return WriteChunk(write, "IEND", std::span<const std::byte>{});
+}
+} // namespace
+
+bool WritePng(const fs::path& path, const cv::Mat& image, const PngWriteOptions& options)
+{
+    if (!CanWritePng(image))
+    {
+        return false;
+    }
+
+    FILE* file{ fopen(path.string().c_str(), "wb") };
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    // Larger stdio buffer so the compressed stream goes out in few large writes
+    setvbuf(file, nullptr, _IOFBF, 1 << 16);
+
+    const bool written{
+        UseParallelWriter(image, options)
+            ? WritePngParallel(image,
+                               options,
+                               [file](std::span<const std::byte> data)
+                               {
+                                   return fwrite(data.data(), 1, data.size(), file) == data.size();
+                               })
+            : WritePngWith(image,
+                           options,
+                           [file](png_structp png)
+                           {
+                               png_init_io(png, file);
+                           }),
+    };
+    return fclose(file) == 0 && written;
+}
+
+EncodedImage EncodePng(const cv::Mat& image, const PngWriteOptions& options)
+{
+    if (!CanWritePng(image))
+    {
+        return {};
+    }
+
+    static constexpr auto c_AppendToBuffer{
+        [](png_structp png, png_bytep data, png_size_t length)
+        {
+            auto& buffer{ *static_cast<EncodedImage*>(png_get_io_ptr(png)) };
+            const auto* bytes{ reinterpret_cast<const std::byte*>(data) };
+            buffer.insert(buffer.end(), bytes, bytes + length);
+        }
+    };
+
+    // Guess a typical compression ratio up front to avoid most regrowing
+    EncodedImage buffer;
+    buffer.reserve(image.total() * image.elemSize() / 4);
+
+    const bool encoded{
+        UseParallelWriter(image, options)
+            ? WritePngParallel(image,
+                               options,
+                               [&buffer](std::span<const std::byte> data)
+                               {
+                                   buffer.insert(buffer.end(), data.begin(), data.end());
+                                   return true;
+                               })
+            : WritePngWith(image,
+                           options,
+                           [&buffer](png_structp png)
+                           {
+                               png_set_write_fn(png, &buffer, c_AppendToBuffer, nullptr);
+                           }),
+    };
+    if (!encoded)
+    {
+        return {};
+    }
+    return buffer;
+}
@@ -0,0 +1,251 @@
+#include <ppp/project/crop_pipeline.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include <QThread>
+
+#include <fmt/format.h>
+
+#include <ppp/png_writer.hpp>
+#include <ppp/qt_util.hpp>
+
+#include <ppp/project/image_ops.hpp>
+
+CropPipeline::Stage::Stage(std::string_view name, size_t queue_depth, std::function<void(CropJob&)> work)
+    : m_Name{ name }
+    , m_TimingMetric{ fmt::format("crop.stage.{}", name) }
+    , m_QueueMetric{ fmt::format("queue.crop.stage.{}", name) }
+    , m_Work{ std::move(work) }
+    , m_Queue{ queue_depth }
+{
+}
+
+CropPipeline::CropPipeline(const Config& config, DecodedImageCache& image_cache, MetricsRegistry& metrics)
+    : m_Metrics{ metrics }
+{
+    const std::array<std::function<void(CropJob&)>, 4> stage_work{
+        [&image_cache](CropJob& job)
+        {
+            job.m_Image = job.m_Source.has_value() ? image_cache.Read(job.m_Source.value()) : image_cache.Read(job.m_InputFile);
+
+            // Free the source bytes right away, they are not needed past decoding
+            job.m_Source.reset();
+            if (!job.m_Image.Valid())
+            {
+                throw std::runtime_error{ "Failed reading image" };
+            }
+        },
+        [](CropJob& job)
+        {
+            ImageTransform transform{
+                CropTransform(job.m_Image,
+                              job.m_CardName,
+                              job.m_CardSize,
+                              job.m_FullBleedEdge,
+                              job.m_BleedEdge,
+                              job.m_MaxDensity),
+            };
+            transform.m_ColorCube = job.m_ColorCube;
+            job.m_Image = TransformImage(job.m_Image, transform);
+        },
+        [png_options = PngWriteOptions{
+             .m_Compression{ config.m_CropPngCompression },
+             .m_Strategy = config.m_CropPngStrategy,
+             .m_Parallel = config.m_CropPngParallel,
+         }](CropJob& job)
+        {
+            if (job.m_OutputFile.extension() == ".png")
+            {
+                PngWriteOptions options{ png_options };
+                options.m_Density = job.m_Image.Density(job.m_CardSizeWithBleed);
+                job.m_Encoded = EncodePng(job.m_Image.GetUnderlying(), options);
+            }
+            else
+            {
+                job.m_Encoded = job.m_Image.Encode(job.m_OutputFile.extension(), std::nullopt, 95, job.m_CardSizeWithBleed);
+            }
+            job.m_Image = Image{};
+            if (job.m_Encoded.empty())
+            {
+                throw std::runtime_error{ "Failed encoding image" };
+            }
+        },
+        [](CropJob& job)
+        {
+            // Replace rather than overwrite, the previous output may be a hard link into the crop store
+            std::error_code error_code;
+            fs::remove(job.m_OutputFile, error_code);
+
+            if (!Image::WriteEncoded(job.m_OutputFile, job.m_Encoded))
+            {
+                throw std::runtime_error{ "Failed writing image" };
+            }
+            job.m_Encoded = EncodedImage{};
+        },
+    };
+
+    const auto stage_configs{ config.CropStages() };
+
+    // Stages without a thread count share the hardware threads instead of each taking all of them
+    const auto num_shared_stages{
+        std::ranges::count_if(stage_configs,
+                              [](const auto& stage_config)
+                              {
+                                  return stage_config.second->m_Threads == 0;
+                              }),
+    };
+    const uint32_t shared_stage_threads{
+        num_shared_stages > 0
+            ? std::max(std::thread::hardware_concurrency() / static_cast<uint32_t>(num_shared_stages), 1u)
+            : 1u
+    };
+
+    for (size_t i = 0; i < stage_configs.size(); i++)
+    {
+        const auto& [stage_name, stage_config]{ stage_configs[i] };
+        m_Stages.push_back(std::make_unique<Stage>(stage_name, stage_config->m_QueueDepth, stage_work[i]));
+
+        Stage& stage{ *m_Stages.back() };
+        const uint32_t num_threads{
+            stage_config->m_Threads != 0
+                ? stage_config->m_Threads
+                : shared_stage_threads
+        };
+        for (uint32_t j = 0; j < num_threads; j++)
+        {
+            QThread* stage_thread{ QThread::create(&CropPipeline::StageLoop, this, i) };
+            stage_thread->setObjectName(QString{ "Crop %1 Thread %2" }.arg(ToQString(stage_name)).arg(j));
+            stage.m_Threads.push_back(stage_thread);
+        }
+    }
+
+    m_StatsStartPoint.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+    for (auto& stage : m_Stages)
+    {
+        for (QThread* stage_thread : stage->m_Threads)
+        {
+            stage_thread->start();
+        }
+    }
+}
+
+CropPipeline::~CropPipeline()
+{
+    Stop();
+}
+
+bool CropPipeline::Submit(std::unique_ptr<CropJob> job)
+{
+    if (!m_Stages.front()->m_Queue.Push(std::move(job)))
+    {
+        job->m_OnDone(CropJobResult::Cancelled);
+        return false;
+    }
+    return true;
+}
+
+void CropPipeline::Stop()
+{
+    if (std::exchange(m_Stopped, true))
+    {
+        return;
+    }
+
+    // Stop stages front to back, so stages that are still running keep draining into the next stage
+    for (auto& stage : m_Stages)
+    {
+        for (auto& job : stage->m_Queue.Close())
+        {
+            job->m_OnDone(CropJobResult::Cancelled);
+        }
+
+        for (QThread* stage_thread : stage->m_Threads)
+        {
+            stage_thread->wait();
+            delete stage_thread;
+        }
+        stage->m_Threads.clear();
+    }
+}
+
+std::vector<CropPipeline::StageStats> CropPipeline::TakeStageStats()
+{
+    const time_point now{ std::chrono::steady_clock::now() };
+    const time_point start_point{ m_StatsStartPoint.exchange(now, std::memory_order_relaxed) };
+    const auto elapsed{ std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_point) };
+
+    std::vector<StageStats> stats{};
+    for (auto& stage : m_Stages)
+    {
+        const auto busy_time{ stage->m_BusyTime.exchange(0, std::memory_order_relaxed) };
+        const auto num_threads{ static_cast<uint32_t>(stage->m_Threads.size()) };
+        const auto available_time{ static_cast<float>(elapsed.count()) * num_threads };
+        stats.push_back(StageStats{
+            .m_Name{ stage->m_Name },
+            .m_Threads = num_threads,
+            .m_QueueCapacity = stage->m_Queue.Capacity(),
+            .m_Queued = stage->m_Queue.Size(),
+            .m_PeakQueued = stage->m_Queue.TakePeakSize(),
+            .m_Busy = stage->m_Busy.load(std::memory_order_relaxed),
+            .m_Processed = stage->m_Processed.exchange(0, std::memory_order_relaxed),
+            .m_Utilization = available_time > 0.0f ? std::min(busy_time / available_time, 1.0f) : 0.0f,
+        });
+    }
+    return stats;
+}
+
+void CropPipeline::StageLoop(size_t stage_index)
+{
+    Stage& stage{ *m_Stages[stage_index] };
+    const bool is_last_stage{ stage_index + 1 == m_Stages.size() };
+
+    while (auto job{ stage.m_Queue.Pop() })
+    {
+        std::unique_ptr<CropJob> current_job{ std::move(job).value() };
+        m_Metrics.SetGauge(stage.m_QueueMetric, static_cast<double>(stage.m_Queue.Size()));
+
+        if (current_job->m_IsCancelled())
+        {
+            current_job->m_OnDone(CropJobResult::Cancelled);
+            continue;
+        }
+
+        stage.m_Busy.fetch_add(1, std::memory_order_relaxed);
+        const time_point start_point{ std::chrono::steady_clock::now() };
+        const bool success{
+            [&]()
+            {
+                try
+                {
+                    stage.m_Work(*current_job);
+                    return true;
+                }
+                catch (...)
+                {
+                    return false;
+                }
+            }()
+        };
+        const auto busy_time{ std::chrono::steady_clock::now() - start_point };
+        m_Metrics.RecordTiming(stage.m_TimingMetric, busy_time);
+        stage.m_BusyTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(busy_time).count(),
+                                   std::memory_order_relaxed);
+        stage.m_Processed.fetch_add(1, std::memory_order_relaxed);
+        stage.m_Busy.fetch_sub(1, std::memory_order_relaxed);
+
+        if (!success)
+        {
+            current_job->m_OnDone(CropJobResult::Failed);
+        }
+        else if (is_last_stage)
+        {
+            current_job->m_OnDone(CropJobResult::Success);
+        }
+        else if (!m_Stages[stage_index + 1]->m_Queue.Push(std::move(current_job)))
+        {
+            current_job->m_OnDone(CropJobResult::Cancelled);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#include <ppp/project/crop_store.hpp>
+
+#include <fmt/format.h>
+
+#include <ppp/file_hash.hpp>
+
+CropStore::CropStore(const fs::path& crop_dir)
+    : m_Dir{ crop_dir / c_DirName }
+{
+}
+
+std::string CropStore::Key(const QByteArray& source_hash,
+                           const ImageParameters& params,
+                           Length bleed_edge,
+                           std::string_view color_cube,
+                           const fs::path& extension)
+{
+    const std::string parameters{
+        fmt::format("{}|{}|{}|{}|{}|{}|{}|{}",
+                    source_hash.toHex().toStdString(),
+                    params.m_DPI.value,
+                    params.m_Width.value,
+                    params.m_CardSize.x / 1_mm,
+                    params.m_CardSize.y / 1_mm,
+                    params.m_FullBleedEdge / 1_mm,
+                    bleed_edge / 1_mm,
+                    color_cube),
+    };
+    const QByteArray key_hash{ HashBytes(std::as_bytes(std::span{ parameters })) };
+    return key_hash.toHex().toStdString() + extension.string();
+}
+
+bool CropStore::Fetch(std::string_view key, const fs::path& output) const
+{
+    const fs::path stored{ m_Dir / key };
+    if (!fs::exists(stored))
+    {
+        return false;
+    }
+
+    // A copy would not keep the stored crop alive, crop again instead
+    return HardLink(stored, output);
+}
+
+bool CropStore::Put(std::string_view key, const fs::path& output) const
+{
+    std::error_code error_code;
+    fs::create_directories(m_Dir, error_code);
+
+    const fs::path stored{ m_Dir / key };
+    if (fs::exists(stored))
+    {
+        return true;
+    }
+
+    // Another worker may store the same crop at the same time, whichever link is made first wins
+    fs::create_hard_link(output, stored, error_code);
+    return !error_code || fs::exists(stored, error_code);
+}
+
+size_t CropStore::Prune() const
+{
+    std::error_code error_code;
+    if (!fs::exists(m_Dir, error_code))
+    {
+        return 0;
+    }
+
+    size_t pruned{ 0 };
+    for (const fs::directory_entry& entry : fs::directory_iterator{ m_Dir, error_code })
+    {
+        if (entry.is_regular_file(error_code) && entry.hard_link_count(error_code) == 1)
+        {
+            if (fs::remove(entry.path(), error_code))
+            {
+                pruned++;
+            }
+        }
+    }
+    return pruned;
+}
+
+bool CropStore::Link(const fs::path& from, const fs::path& to)
+{
+    if (HardLink(from, to))
+    {
+        return true;
+    }
+
+    std::error_code error_code;
+    return fs::copy_file(from, to, fs::copy_options::overwrite_existing, error_code) && !error_code;
+}
+
+bool CropStore::HardLink(const fs::path& from, const fs::path& to)
+{
+    // Don't write through the existing file, it may itself be linked into the store
+    std::error_code error_code;
+    fs::remove(to, error_code);
+
+    fs::create_hard_link(from, to, error_code);
+    return !error_code;
+}
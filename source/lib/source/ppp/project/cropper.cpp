@@ -1,10 +1,11 @@
 #include <ppp/project/cropper.hpp>
 
+#include <fstream>
 #include <ranges>
+#include <thread>
 
 #include <QDebug>
 #include <QThread>
-#include <QTimer>
 
 #include <fmt/chrono.h>
 
@@ -12,101 +13,101 @@
 
 #include <ppp/util/log.hpp>
 
-#include <ppp/project/cropper_signal_router.hpp>
+#include <ppp/project/crop_store.hpp>
 #include <ppp/project/image_ops.hpp>
 
-Cropper::Cropper(std::function<const cv::Mat*(std::string_view)> get_color_cube, const Project& project)
+Cropper::Cropper(std::function<const ColorCube*(std::string_view)> get_color_cube, const Project& project)
     : m_GetColorCube{ std::move(get_color_cube) }
     , m_ImageDB{ ImageDataBase::Read(project.m_Data.m_CropDir / ".image.db") }
     , m_Data{ project.m_Data }
     , m_Cfg{ g_Cfg }
     , m_LoadedPreviews{ project.m_Data.m_Previews | std::views::keys | std::ranges::to<std::vector>() }
+    , m_ImageCache{ size_t{ m_Cfg.m_ImageCacheSize } * 1024 * 1024 }
 {
 }
 Cropper::~Cropper()
 {
-    m_Quit.store(true, std::memory_order_relaxed);
-    while (m_ThreadsDone != 2)
-        /* spin */;
-
-    m_CropThread->quit();
-    m_PreviewThread->quit();
-
-    m_CropThread->wait();
-    m_PreviewThread->wait();
+    {
+        std::lock_guard lock{ m_WorkMutex };
+        m_Quit.store(true, std::memory_order_relaxed);
+    }
+    m_WorkAvailable.notify_all();
 
-    delete m_CropTimer;
-    delete m_PreviewTimer;
+    for (QThread* worker_thread : m_WorkerThreads)
+    {
+        worker_thread->wait();
+        delete worker_thread;
+    }
 
-    delete m_CropThread;
-    delete m_PreviewThread;
+    m_CropPipeline->Stop();
 
-    delete m_Router;
+    m_CropperThread->quit();
+    m_CropperThread->wait();
+    delete m_CropperThread;
 
     m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
+    WriteDuplicates();
 }
 
 void Cropper::Start()
 {
-    m_Router = new CropperSignalRouter;
-    m_Router->SetWork(std::bind_front(&Cropper::PreviewWork, this));
-    QObject::connect(m_Router, &CropperSignalRouter::CropWorkStart, this, &Cropper::CropWorkStart);
-    QObject::connect(m_Router, &CropperSignalRouter::CropWorkDone, this, &Cropper::CropWorkDone);
-    QObject::connect(m_Router, &CropperSignalRouter::PreviewWorkStart, this, &Cropper::PreviewWorkStart);
-    QObject::connect(m_Router, &CropperSignalRouter::PreviewWorkDone, this, &Cropper::PreviewWorkDone);
-    QObject::connect(m_Router, &CropperSignalRouter::CropProgress, this, &Cropper::CropProgress);
-    QObject::connect(m_Router, &CropperSignalRouter::PreviewUpdated, this, &Cropper::PreviewUpdated);
-
-    m_CropThread = new QThread{};
-    m_CropThread->setObjectName("Cropper Crop Work Thread");
-    this->moveToThread(m_CropThread);
-
-    m_PreviewThread = new QThread{};
-    m_PreviewThread->setObjectName("Cropper Preview Work Thread");
-    m_Router->moveToThread(m_PreviewThread);
-
-    using QTimerStart = void (QTimer::*)();
-    static constexpr QTimerStart timer_start{ &QTimer::start };
-
-    m_CropTimer = new QTimer;
-    m_CropTimer->setInterval(5);
-    m_CropTimer->setSingleShot(true);
-    QObject::connect(m_CropTimer, &QTimer::timeout, this, &Cropper::CropWork);
-    QObject::connect(this, &Cropper::RestartTimers, m_CropTimer, timer_start);
-    m_CropTimer->start();
-    m_CropTimer->moveToThread(m_CropThread);
-
-    m_PreviewTimer = new QTimer;
-    m_PreviewTimer->setInterval(5);
-    m_PreviewTimer->setSingleShot(true);
-    QObject::connect(m_PreviewTimer, &QTimer::timeout, m_Router, &CropperSignalRouter::DoWork);
-    QObject::connect(this, &Cropper::RestartTimers, m_PreviewTimer, timer_start);
-    m_PreviewTimer->start();
-    m_PreviewTimer->moveToThread(m_PreviewThread);
-
-    m_CropThread->start();
-    m_PreviewThread->start();
+    m_CropperThread = new QThread{};
+    m_CropperThread->setObjectName("Cropper Thread");
+    this->moveToThread(m_CropperThread);
+
+    const uint32_t num_workers{
+        m_Cfg.m_CropperThreads != 0
+            ? m_Cfg.m_CropperThreads
+            : std::max(std::thread::hardware_concurrency(), 1u)
+    };
+    m_CropPipeline = std::make_unique<CropPipeline>(m_Cfg, m_ImageCache, m_Metrics);
+
+    m_WorkerThreads.reserve(num_workers);
+    for (uint32_t i = 0; i < num_workers; i++)
+    {
+        QThread* worker_thread{ QThread::create(&Cropper::WorkLoop, this, m_WorkerThreads.size()) };
+        worker_thread->setObjectName(QString{ "Cropper Work Thread %1" }.arg(i));
+        m_WorkerThreads.push_back(worker_thread);
+    }
+
+    m_CropperThread->start();
+    for (QThread* worker_thread : m_WorkerThreads)
+    {
+        worker_thread->start();
+    }
+}
+
+const MetricsRegistry& Cropper::GetMetrics() const
+{
+    return m_Metrics;
 }
 
 void Cropper::ClearCropWork()
 {
+    m_CropGeneration.fetch_add(1, std::memory_order_relaxed);
+
     std::lock_guard work_lock{ m_PendingCropWorkMutex };
-    m_PendingCropWork.clear();
+    m_PendingCropWork.Clear();
+    m_DeferredCropWork.clear();
+    m_CropRetries.clear();
 }
 
 void Cropper::ClearPreviewWork()
 {
     std::lock_guard work_lock{ m_PendingPreviewWorkMutex };
-    m_PendingPreviewWork.clear();
+    m_PendingPreviewWork.Clear();
+    m_DeferredPreviewWork.clear();
+    m_PreviewRetries.clear();
 }
 
 void Cropper::NewProjectOpenedDiff(const Project::ProjectData& data)
 {
-    {
-        std::unique_lock lock{ m_ImageDBMutex };
-        m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
-        m_ImageDB = ImageDataBase::Read(data.m_CropDir / ".image.db");
-    }
+    m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
+    m_ImageDB.Reset(data.m_CropDir / ".image.db");
+    m_ImageCache.Clear();
+    ResetDuplicates();
+    ClearSharedPreviews();
+    m_CropStoreUnsupported.store(false, std::memory_order_relaxed);
 
     std::unique_lock lock{ m_PropertyMutex };
     m_Data = data;
@@ -115,11 +116,12 @@ void Cropper::NewProjectOpenedDiff(const Project::ProjectData& data)
 
 void Cropper::ImageDirChangedDiff(const fs::path& image_dir, const fs::path& crop_dir, const std::vector<fs::path>& loaded_previews)
 {
-    {
-        std::unique_lock lock{ m_ImageDBMutex };
-        m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
-        m_ImageDB = ImageDataBase::Read(crop_dir / ".image.db");
-    }
+    m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
+    m_ImageDB.Reset(crop_dir / ".image.db");
+    m_ImageCache.Clear();
+    ResetDuplicates();
+    ClearSharedPreviews();
+    m_CropStoreUnsupported.store(false, std::memory_order_relaxed);
 
     std::unique_lock lock{ m_PropertyMutex };
     m_Data.m_ImageDir = image_dir;
@@ -129,18 +131,24 @@ void Cropper::ImageDirChangedDiff(const fs::path& image_dir, const fs::path& cro
 
 void Cropper::CardSizeChangedDiff(std::string card_size)
 {
+    ClearSharedPreviews();
+
     std::unique_lock lock{ m_PropertyMutex };
     m_Data.m_CardSizeChoice = std::move(card_size);
+    m_CropGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 void Cropper::BleedChangedDiff(Length bleed)
 {
     std::unique_lock lock{ m_PropertyMutex };
     m_Data.m_BleedEdge = bleed;
+    m_CropGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 void Cropper::EnableUncropChangedDiff(bool enable_uncrop)
 {
+    ClearSharedPreviews();
+
     std::unique_lock lock{ m_PropertyMutex };
     m_Cfg.m_EnableUncrop = enable_uncrop;
 }
@@ -149,10 +157,13 @@ void Cropper::ColorCubeChangedDiff(const std::string& cube_name)
 {
     std::unique_lock lock{ m_PropertyMutex };
     m_Cfg.m_ColorCube = cube_name;
+    m_CropGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 void Cropper::BasePreviewWidthChangedDiff(Pixel base_preview_width)
 {
+    ClearSharedPreviews();
+
     std::unique_lock lock{ m_PropertyMutex };
     m_Cfg.m_BasePreviewWidth = base_preview_width;
 }
@@ -161,18 +172,26 @@ void Cropper::MaxDPIChangedDiff(PixelDensity dpi)
 {
     std::unique_lock lock{ m_PropertyMutex };
     m_Cfg.m_MaxDPI = dpi;
+    m_CropGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 void Cropper::CardAdded(const fs::path& card_name, bool needs_crop, bool needs_preview)
 {
+    UpdateDuplicates(card_name);
     PushWork(card_name, needs_crop, needs_preview);
 }
 
 void Cropper::CardRemoved(const fs::path& card_name)
 {
     RemoveWork(card_name);
+    UpdateDuplicates(card_name);
 
-    std::erase(m_LoadedPreviews, card_name);
+    {
+        std::unique_lock lock{ m_PropertyMutex };
+        std::erase(m_LoadedPreviews, card_name);
+        m_ImageCache.Erase(m_Data.m_ImageDir / card_name);
+        m_ImageCache.Erase(m_Data.m_CropDir / card_name);
+    }
 
     if (m_Pause.load(std::memory_order_relaxed))
     {
@@ -219,47 +238,266 @@ void Cropper::CardRenamed(const fs::path& old_card_name, const fs::path& new_car
             fs::rename(entry.path() / old_card_name, entry.path() / new_card_name);
         }
     }
+
+    UpdateDuplicates(old_card_name);
+    UpdateDuplicates(new_card_name);
 }
 
 void Cropper::CardModified(const fs::path& card_name)
 {
+    UpdateDuplicates(card_name);
     PushWork(card_name, true, true);
 }
 
+void Cropper::VisibleCardsChanged(const std::vector<fs::path>& card_names)
+{
+    std::lock_guard lock{ m_PendingPreviewWorkMutex };
+    m_VisibleCards = card_names | std::ranges::to<std::unordered_set>();
+    m_PendingPreviewWork.MoveToFront(card_names);
+}
+
 void Cropper::PauseWork()
 {
-    m_Pause.store(true, std::memory_order_relaxed);
-    while (m_ThreadsPaused != 2)
-        /* spin */;
+    {
+        std::lock_guard lock{ m_WorkMutex };
+        m_Pause.store(true, std::memory_order_relaxed);
+    }
+    m_WorkAvailable.notify_all();
+
+    std::unique_lock lock{ m_WorkMutex };
+    while (!m_WorkerPaused.wait_for(lock,
+                                    c_PauseReportInterval,
+                                    [this]()
+                                    {
+                                        return m_ThreadsPaused == m_WorkerThreads.size() &&
+                                               m_CropsInFlight.load(std::memory_order_relaxed) == 0;
+                                    }))
+    {
+        lock.unlock();
+        const std::vector<fs::path> work_in_flight{ GetWorkInFlight() };
+        LogInfo("Pausing cropper, waiting for work to drain: {}",
+                work_in_flight |
+                    std::views::transform([](const fs::path& card_name)
+                                          { return card_name.string(); }) |
+                    std::views::join_with(std::string_view{ ", " }) |
+                    std::ranges::to<std::string>());
+        lock.lock();
+    }
 }
 
 void Cropper::RestartWork()
 {
     if (m_Pause.load(std::memory_order_relaxed))
     {
-        m_ThreadsPaused.store(0, std::memory_order_relaxed);
-        m_Pause.store(false, std::memory_order_relaxed);
-        RestartTimers(QPrivateSignal{});
+        {
+            std::lock_guard lock{ m_WorkMutex };
+            m_Pause.store(false, std::memory_order_relaxed);
+        }
+        m_WorkAvailable.notify_all();
+    }
+}
+
+void Cropper::BuildDuplicates()
+{
+    fs::path image_dir;
+    fs::path duplicates_path;
+    bool near_duplicates;
+    {
+        std::shared_lock lock{ m_PropertyMutex };
+        if (!m_Cfg.m_DeduplicateCards || m_Cfg.m_EnableUncrop)
+        {
+            return;
+        }
+
+        image_dir = m_Data.m_ImageDir;
+        duplicates_path = m_Data.m_CropDir / DuplicateIndex::c_FileName;
+        near_duplicates = m_Cfg.m_DetectNearDuplicates;
+    }
+
+    {
+        std::shared_lock lock{ m_DuplicatesMutex };
+        if (m_Duplicates.has_value() && m_DuplicatesImageDir == image_dir)
+        {
+            return;
+        }
+    }
+
+    std::unique_lock lock{ m_DuplicatesMutex };
+    if (m_Duplicates.has_value() && m_DuplicatesImageDir == image_dir)
+    {
+        return;
+    }
+
+    m_Duplicates = DuplicateIndex::Build(image_dir, duplicates_path, near_duplicates);
+    m_DuplicatesImageDir = std::move(image_dir);
+    m_DuplicatesPath = std::move(duplicates_path);
+    m_Duplicates->Write(m_DuplicatesPath);
+
+    const DuplicateIndex::Report& report{ m_Duplicates->GetReport() };
+    LogInfo("Duplicate Index: {} Images, {} Hashed in {}, {} Groups, {} Duplicates, {} MB Duplicated Sources",
+            report.m_Images,
+            report.m_Hashed,
+            report.m_Duration,
+            report.m_Groups,
+            report.m_Duplicates,
+            report.m_DuplicateBytes / (1024 * 1024));
+}
+
+void Cropper::UpdateDuplicates(const fs::path& card_name)
+{
+    fs::path image_dir;
+    {
+        std::shared_lock lock{ m_DuplicatesMutex };
+        if (!m_Duplicates.has_value())
+        {
+            return;
+        }
+        image_dir = m_DuplicatesImageDir;
+    }
+
+    // Hashing reads and decodes the whole image, workers would wait on it if we held the index meanwhile
+    std::optional<DuplicateIndexEntry> entry{ DuplicateIndex::Hash(image_dir, card_name) };
+
+    std::unique_lock lock{ m_DuplicatesMutex };
+    if (m_Duplicates.has_value() && m_DuplicatesImageDir == image_dir)
+    {
+        m_Duplicates->Update(card_name, std::move(entry));
+    }
+}
+
+void Cropper::WriteDuplicates()
+{
+    std::shared_lock lock{ m_DuplicatesMutex };
+    if (m_Duplicates.has_value())
+    {
+        m_Duplicates->Write(m_DuplicatesPath);
+    }
+}
+
+void Cropper::ResetDuplicates()
+{
+    std::unique_lock lock{ m_DuplicatesMutex };
+    if (m_Duplicates.has_value())
+    {
+        m_Duplicates->Write(m_DuplicatesPath);
+        m_Duplicates.reset();
+    }
+}
+
+fs::path Cropper::CanonicalCard(const fs::path& card_name)
+{
+    std::shared_lock lock{ m_DuplicatesMutex };
+    return m_Duplicates.has_value() ? m_Duplicates->Canonical(card_name) : card_name;
+}
+
+std::vector<fs::path> Cropper::DuplicateCards(const fs::path& canonical_name)
+{
+    std::shared_lock lock{ m_DuplicatesMutex };
+    return m_Duplicates.has_value() ? m_Duplicates->Duplicates(canonical_name) : std::vector<fs::path>{};
+}
+
+QByteArray Cropper::SharedContentHash(const fs::path& canonical_name)
+{
+    std::shared_lock lock{ m_DuplicatesMutex };
+    if (!m_Duplicates.has_value() || m_Duplicates->Duplicates(canonical_name).empty())
+    {
+        return {};
+    }
+    return m_Duplicates->ContentHash(canonical_name);
+}
+
+std::optional<SourceFile> Cropper::OpenSource(const fs::path& image_dir, const fs::path& card_name)
+{
+    std::optional<SourceFile> source{ SourceFile::Open(image_dir / card_name) };
+    if (source.has_value())
+    {
+        // The duplicate index hashed all sources already, don't read them a second time just to hash them
+        std::shared_lock lock{ m_DuplicatesMutex };
+        if (m_Duplicates.has_value() && m_DuplicatesImageDir == image_dir)
+        {
+            QByteArray content_hash{ m_Duplicates->ContentHash(card_name, source->Stat()) };
+            if (!content_hash.isEmpty())
+            {
+                source->SetHash(std::move(content_hash));
+            }
+        }
+    }
+    return source;
+}
+
+void Cropper::ClearSharedPreviews()
+{
+    std::lock_guard lock{ m_SharedPreviewsMutex };
+    m_SharedPreviews.clear();
+}
+
+void Cropper::NotifyWorkers(uint32_t num_new_work)
+{
+    {
+        std::lock_guard lock{ m_WorkMutex };
+        m_WorkEpoch++;
+    }
+
+    for (uint32_t i = 0; i < num_new_work; i++)
+    {
+        m_WorkAvailable.notify_one();
+    }
+}
+
+std::vector<fs::path> Cropper::GetWorkInFlight()
+{
+    std::vector<fs::path> work_in_flight{};
+    {
+        std::lock_guard lock{ m_PendingCropWorkMutex };
+        work_in_flight.append_range(m_CropWorkInFlight);
+    }
+    {
+        std::lock_guard lock{ m_PendingPreviewWorkMutex };
+        for (const fs::path& card_name : m_PreviewWorkInFlight)
+        {
+            if (!std::ranges::contains(work_in_flight, card_name))
+            {
+                work_in_flight.push_back(card_name);
+            }
+        }
     }
+    return work_in_flight;
 }
 
 void Cropper::PushWork(const fs::path& card_name, bool needs_crop, bool needs_preview)
 {
+    uint32_t num_new_work{ 0 };
     if (needs_crop)
     {
         std::lock_guard lock{ m_PendingCropWorkMutex };
-        if (!std::ranges::contains(m_PendingCropWork, card_name))
+        if (m_CropWorkInFlight.contains(card_name))
+        {
+            // Some worker is on this card already, redo it once that worker is done
+            m_DeferredCropWork.insert(card_name);
+        }
+        else if (m_PendingCropWork.Push(card_name))
         {
-            m_PendingCropWork.push_back(card_name);
+            num_new_work++;
         }
     }
     if (needs_preview)
     {
         std::lock_guard lock{ m_PendingPreviewWorkMutex };
-        if (!std::ranges::contains(m_PendingPreviewWork, card_name))
+        if (m_PreviewWorkInFlight.contains(card_name))
         {
-            m_PendingPreviewWork.push_back(card_name);
+            // Some worker is on this card already, redo it once that worker is done
+            m_DeferredPreviewWork.insert(card_name);
         }
+        else if (m_VisibleCards.contains(card_name) ? m_PendingPreviewWork.PushFront(card_name)
+                                                    : m_PendingPreviewWork.Push(card_name))
+        {
+            num_new_work++;
+        }
+    }
+
+    if (num_new_work != 0)
+    {
+        NotifyWorkers(num_new_work);
     }
 }
 
@@ -267,126 +505,338 @@ void Cropper::RemoveWork(const fs::path& card_name)
 {
     {
         std::lock_guard lock{ m_PendingCropWorkMutex };
-        auto it{ std::ranges::find(m_PendingCropWork, card_name) };
-        if (it != m_PendingCropWork.end())
-        {
-            m_PendingCropWork.erase(it);
-        }
+        m_PendingCropWork.Remove(card_name);
+        m_DeferredCropWork.erase(card_name);
+        m_CropRetries.erase(card_name);
     }
     {
         std::lock_guard lock{ m_PendingPreviewWorkMutex };
-        auto it{ std::ranges::find(m_PendingPreviewWork, card_name) };
-        if (it != m_PendingPreviewWork.end())
+        m_PendingPreviewWork.Remove(card_name);
+        m_DeferredPreviewWork.erase(card_name);
+        m_PreviewRetries.erase(card_name);
+    }
+}
+
+void Cropper::FinishCropWork(const fs::path& card_name)
+{
+    {
+        std::lock_guard lock{ m_PendingCropWorkMutex };
+        m_CropWorkInFlight.erase(card_name);
+
+        // Work that failed is delayed before it finishes, anything else is done retrying
+        if (!m_PendingCropWork.Contains(card_name))
+        {
+            m_CropRetries.erase(card_name);
+        }
+
+        if (m_DeferredCropWork.erase(card_name) == 0 || !m_PendingCropWork.Push(card_name))
         {
-            m_PendingPreviewWork.erase(it);
+            return;
         }
     }
+
+    NotifyWorkers(1);
 }
 
-void Cropper::CropWork()
+bool Cropper::RetryLater(WorkQueue& queue, std::unordered_map<fs::path, uint32_t>& retries, const fs::path& card_name)
 {
-    if (m_Pause.load(std::memory_order_relaxed))
+    uint32_t& attempts{ retries[card_name] };
+    if (attempts >= c_MaxRetries)
     {
-        m_ThreadsPaused++;
-        return;
+        retries.erase(card_name);
+        return false;
+    }
+
+    queue.PushDelayed(card_name, std::chrono::steady_clock::now() + c_RetryDelay * (1 << attempts));
+    attempts++;
+    return true;
+}
+
+void Cropper::RetryCropWork(const fs::path& card_name)
+{
+    std::lock_guard lock{ m_PendingCropWorkMutex };
+    if (!RetryLater(m_PendingCropWork, m_CropRetries, card_name))
+    {
+        LogInfo("Failed cropping {} {} times, giving up until it changes", card_name.string(), c_MaxRetries + 1);
     }
+}
 
-    if (m_Quit.load(std::memory_order_relaxed))
+void Cropper::RetryPreviewWork(const fs::path& card_name)
+{
+    std::lock_guard lock{ m_PendingPreviewWorkMutex };
+    if (!RetryLater(m_PendingPreviewWork, m_PreviewRetries, card_name))
     {
-        m_ThreadsDone++;
-        return;
+        LogInfo("Failed previewing {} {} times, giving up until it changes", card_name.string(), c_MaxRetries + 1);
     }
+}
 
-    if (DoCropWork(this))
+void Cropper::CompleteCropWork(const fs::path& card_name)
+{
+    FinishCropWork(card_name);
+    m_LastCropWorkPoint.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+    if (m_CropsInFlight.fetch_sub(1, std::memory_order_relaxed) == 1)
     {
-        if (m_CropDone.load(std::memory_order_relaxed) == 0)
+        // Last crop finished, idle workers need to check whether we are done
+        // and a pending pause needs to check whether all work has drained
         {
-            m_CropWorkStartPoint = std::chrono::high_resolution_clock::now();
-            this->CropWorkStart();
-            m_TotalWorkDone.store(0, std::memory_order_relaxed);
-            m_CropDone.store(c_UpdatesBeforeDoneTrigger, std::memory_order_relaxed);
+            std::lock_guard lock{ m_WorkMutex };
+            m_WorkEpoch++;
         }
+        m_WorkAvailable.notify_all();
+        m_WorkerPaused.notify_all();
     }
-    else
-    {
-        if (m_CropDone.load(std::memory_order_relaxed) != 0)
-        {
-            if (m_CropDone.fetch_sub(1, std::memory_order_relaxed) == 1)
-            {
-                this->CropWorkDone();
+}
 
-                {
-                    std::shared_lock image_db_lock{ m_ImageDBMutex };
-                    std::shared_lock property_lock{ m_PropertyMutex };
-                    m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
-                }
+void Cropper::FinishPreviewWork(const fs::path& card_name)
+{
+    {
+        std::lock_guard lock{ m_PendingPreviewWorkMutex };
+        m_PreviewWorkInFlight.erase(card_name);
 
-                const auto crop_work_end_point{ std::chrono::high_resolution_clock::now() };
-                const auto crop_work_duration{ crop_work_end_point - m_CropWorkStartPoint };
-                LogInfo("Cropper finished...\nTotal Work Items: {}\nTotal Time Taken: {}",
-                        m_TotalWorkDone.load(std::memory_order_relaxed),
-                        std::chrono::duration_cast<std::chrono::seconds>(crop_work_duration));
-            }
+        // Work that failed is delayed before it finishes, anything else is done retrying
+        if (!m_PendingPreviewWork.Contains(card_name))
+        {
+            m_PreviewRetries.erase(card_name);
         }
 
-        // Steal work from preview thread, only if that thread is already working on it
-        // so we don't miss the done signal
-        if (m_PreviewDone.load(std::memory_order_relaxed) != 0)
+        if (m_DeferredPreviewWork.erase(card_name) == 0 || !m_PendingPreviewWork.Push(card_name))
         {
-            DoPreviewWork(this);
+            return;
         }
     }
 
-    m_CropTimer->start();
+    NotifyWorkers(1);
 }
 
-void Cropper::PreviewWork()
+void Cropper::WorkLoop(size_t worker_index)
 {
-    if (m_Pause.load(std::memory_order_relaxed))
+    // Alternate preferences between workers so neither queue starves,
+    // when a worker runs dry it steals from the other queue
+    const bool prefer_crop{ worker_index % 2 == 1 };
+
+    while (true)
     {
-        m_ThreadsPaused++;
-        return;
+        // Remember which work we have seen, so we don't sleep through work pushed while we were busy
+        const uint64_t work_epoch{
+            [this]()
+            {
+                std::lock_guard lock{ m_WorkMutex };
+                return m_WorkEpoch;
+            }()
+        };
+
+        if (m_Quit.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        if (m_Pause.load(std::memory_order_relaxed))
+        {
+            std::unique_lock lock{ m_WorkMutex };
+            m_ThreadsPaused++;
+            m_WorkerPaused.notify_all();
+
+            // Stay counted as paused until we actually wake up, so a quick
+            // restart followed by another pause still sees this worker
+            m_WorkAvailable.wait(lock,
+                                 [this]()
+                                 {
+                                     return !m_Pause.load(std::memory_order_relaxed) ||
+                                            m_Quit.load(std::memory_order_relaxed);
+                                 });
+            m_ThreadsPaused--;
+            continue;
+        }
+
+        const bool did_work{
+            prefer_crop
+                ? DoCropWork(this) || DoPreviewWork(this)
+                : DoPreviewWork(this) || DoCropWork(this)
+        };
+
+        // Check for done after every piece of work too, workers may stay busy with one kind
+        // of work long after the other kind has quieted down, which must not hold back its done
+        const std::optional<time_point> crop_done_check{ CheckCropWorkDone() };
+        const std::optional<time_point> preview_done_check{ CheckPreviewWorkDone() };
+        if (did_work)
+        {
+            continue;
+        }
+
+        const std::optional<time_point> next_done_check{
+            crop_done_check.has_value() && preview_done_check.has_value()
+                ? std::min(crop_done_check, preview_done_check)
+                : crop_done_check.has_value() ? crop_done_check
+                                              : preview_done_check,
+        };
+
+        std::unique_lock lock{ m_WorkMutex };
+        const auto has_news{
+            [&, this]()
+            {
+                return m_WorkEpoch != work_epoch ||
+                       m_Pause.load(std::memory_order_relaxed) ||
+                       m_Quit.load(std::memory_order_relaxed);
+            }
+        };
+        if (next_done_check.has_value())
+        {
+            m_WorkAvailable.wait_until(lock, next_done_check.value(), has_news);
+        }
+        else
+        {
+            m_WorkAvailable.wait(lock, has_news);
+        }
     }
+}
 
-    if (m_Quit.load(std::memory_order_relaxed))
+std::optional<Cropper::time_point> Cropper::CheckCropWorkDone()
+{
+    // Failed work waiting to be retried is not done yet, check again once it is due
+    const std::optional<time_point> next_retry{
+        [this]()
+        {
+            std::lock_guard lock{ m_PendingCropWorkMutex };
+            return m_PendingCropWork.NextDelayed();
+        }()
+    };
+    if (next_retry.has_value())
     {
-        m_ThreadsDone++;
-        return;
+        return next_retry;
     }
 
-    if (DoPreviewWork(m_Router))
+    // Only while no work is in flight, otherwise a long-running job on one worker
+    // could be reported as done by the other workers
+    if (m_CropWorking.load(std::memory_order_relaxed) && m_CropsInFlight.load(std::memory_order_relaxed) == 0)
     {
-        if (m_PreviewDone.load(std::memory_order_relaxed) == 0)
+        const time_point crop_done_point{ m_LastCropWorkPoint.load(std::memory_order_relaxed) + c_QuiescenceBeforeDoneTrigger };
+        if (std::chrono::steady_clock::now() < crop_done_point)
         {
-            m_Router->PreviewWorkStart();
-            m_PreviewDone.store(c_UpdatesBeforeDoneTrigger, std::memory_order_relaxed);
+            return crop_done_point;
         }
-    }
-    else
-    {
-        if (m_PreviewDone.load(std::memory_order_relaxed) != 0)
+        else if (m_CropWorking.exchange(false, std::memory_order_relaxed))
         {
-            if (m_PreviewDone.fetch_sub(1, std::memory_order_relaxed) == 1)
+            this->CropWorkDone();
+
+            // Entries are journaled as they are put, only compact here once the journal grew large
+            m_ImageDB.CompactIfNeeded();
+
+            const std::optional<CropStore> crop_store{
+                [this]() -> std::optional<CropStore>
+                {
+                    std::shared_lock lock{ m_PropertyMutex };
+                    if (!m_Cfg.m_ContentAddressedCrops || m_CropStoreUnsupported.load(std::memory_order_relaxed))
+                    {
+                        return std::nullopt;
+                    }
+                    return CropStore{ m_Data.m_CropDir };
+                }()
+            };
+            if (crop_store.has_value())
+            {
+                const size_t pruned{ crop_store->Prune() };
+                if (pruned > 0)
+                {
+                    LogInfo("Pruned {} crops from the crop store that are no longer used", pruned);
+                }
+            }
+
+            const auto crop_work_duration{ crop_done_point - m_CropWorkStartPoint.load(std::memory_order_relaxed) };
+            LogInfo("Cropper finished...\nTotal Work Items: {}\nTotal Time Taken: {}\nWorker Threads: {}",
+                    m_TotalWorkDone.load(std::memory_order_relaxed),
+                    std::chrono::duration_cast<std::chrono::seconds>(crop_work_duration),
+                    m_WorkerThreads.size());
+            const DecodedImageCache::Stats cache_stats{ m_ImageCache.TakeStats() };
+            LogInfo("Image Cache: {} Hits, {} Misses, {} Images, {} MB",
+                    cache_stats.m_Hits,
+                    cache_stats.m_Misses,
+                    cache_stats.m_Entries,
+                    cache_stats.m_Bytes / (1024 * 1024));
+            {
+                const uint64_t cache_reads{ cache_stats.m_Hits + cache_stats.m_Misses };
+                m_Metrics.SetGauge("image_cache.hit_rate",
+                                   cache_reads != 0
+                                       ? static_cast<double>(cache_stats.m_Hits) / static_cast<double>(cache_reads)
+                                       : 0.0);
+                m_Metrics.SetGauge("image_cache.bytes", static_cast<double>(cache_stats.m_Bytes));
+            }
+
+            for (const CropPipeline::StageStats& stage : m_CropPipeline->TakeStageStats())
             {
-                m_Router->PreviewWorkDone();
+                m_Metrics.SetGauge(fmt::format("crop.stage.{}.utilization", stage.m_Name), stage.m_Utilization);
+                LogInfo("Crop Stage {}: {} Threads, {:.0f}% Busy, Peak Queue {}/{}, {} Items",
+                        stage.m_Name,
+                        stage.m_Threads,
+                        stage.m_Utilization * 100.0f,
+                        stage.m_PeakQueued,
+                        stage.m_QueueCapacity,
+                        stage.m_Processed);
+            }
 
+            WriteDuplicates();
+            LogInfo("Deduplicated: {} Crops, {} Previews",
+                    m_Metrics.GetCount("crop.jobs.deduplicated"),
+                    m_Metrics.GetCount("preview.jobs.deduplicated"));
+
+            m_Metrics.SetGauge("crop.throughput", m_Metrics.GetThroughput("crop.jobs.done"));
+
+            const std::optional<fs::path> metrics_path{
+                [this]() -> std::optional<fs::path>
+                {
+                    std::shared_lock lock{ m_PropertyMutex };
+                    if (!m_Cfg.m_DumpCropperMetrics)
+                    {
+                        return std::nullopt;
+                    }
+                    return m_Data.m_CropDir / c_MetricsFile;
+                }()
+            };
+            if (metrics_path.has_value())
+            {
+                if (std::ofstream metrics_file{ metrics_path.value() })
+                {
+                    metrics_file << m_Metrics.DumpJson();
+                }
+                else
                 {
-                    std::shared_lock image_db_lock{ m_ImageDBMutex };
-                    std::shared_lock property_lock{ m_PropertyMutex };
-                    m_ImageDB.Write(m_Data.m_CropDir / ".image.db");
+                    LogInfo("Failed writing cropper metrics to {}", metrics_path->string());
                 }
             }
         }
+    }
+    return std::nullopt;
+}
 
-        // Steal work from crop thread, only if that thread is already working on it
-        // so we don't miss the done signal
-        if (m_CropDone.load(std::memory_order_relaxed) != 0)
+std::optional<Cropper::time_point> Cropper::CheckPreviewWorkDone()
+{
+    const std::optional<time_point> next_retry{
+        [this]()
         {
-            DoCropWork(m_Router);
-        }
+            std::lock_guard lock{ m_PendingPreviewWorkMutex };
+            return m_PendingPreviewWork.NextDelayed();
+        }()
+    };
+    if (next_retry.has_value())
+    {
+        return next_retry;
     }
 
-    m_PreviewTimer->start();
+    if (m_PreviewWorking.load(std::memory_order_relaxed) && m_PreviewsInFlight.load(std::memory_order_relaxed) == 0)
+    {
+        const time_point preview_done_point{ m_LastPreviewWorkPoint.load(std::memory_order_relaxed) + c_QuiescenceBeforeDoneTrigger };
+        if (std::chrono::steady_clock::now() < preview_done_point)
+        {
+            return preview_done_point;
+        }
+        else if (m_PreviewWorking.exchange(false, std::memory_order_relaxed))
+        {
+            this->PreviewWorkDone();
+
+            // Entries are journaled as they are put, only compact here once the journal grew large
+            m_ImageDB.CompactIfNeeded();
+        }
+    }
+    return std::nullopt;
 }
 
 template<class T>
@@ -398,20 +848,33 @@ bool Cropper::DoCropWork(T* signaller)
         float m_Progress;
     };
     auto pop_work{
-        [this]() -> std::optional<Work>
+        [this, signaller]() -> std::optional<Work>
         {
             fs::path first_work_to_do;
             float work_left;
             {
                 std::lock_guard lock{ m_PendingCropWorkMutex };
-                if (m_PendingCropWork.empty())
+                auto next_work{ m_PendingCropWork.Pop() };
+                if (!next_work.has_value())
                 {
                     return std::nullopt;
                 }
 
-                first_work_to_do = std::move(m_PendingCropWork.front());
-                m_PendingCropWork.erase(m_PendingCropWork.begin());
-                work_left = static_cast<float>(m_PendingCropWork.size());
+                first_work_to_do = std::move(next_work).value();
+                m_CropWorkInFlight.insert(first_work_to_do);
+                work_left = static_cast<float>(m_PendingCropWork.Size());
+            }
+            m_Metrics.SetGauge("queue.crop.pending", work_left);
+
+            m_CropsInFlight.fetch_add(1, std::memory_order_relaxed);
+            if (!m_CropWorking.exchange(true, std::memory_order_relaxed))
+            {
+                m_CropWorkStartPoint.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+                m_TotalWorkDone.store(0, std::memory_order_relaxed);
+                m_CropPipeline->TakeStageStats();
+                m_ImageCache.TakeStats();
+                m_Metrics.Reset();
+                signaller->CropWorkStart();
             }
 
             const float work_done{ static_cast<float>(m_TotalWorkDone.fetch_add(1, std::memory_order_relaxed)) };
@@ -426,9 +889,25 @@ bool Cropper::DoCropWork(T* signaller)
     {
         auto [card_name, progress]{ std::move(crop_work_to_do).value() };
 
+        // Once the job is handed to the pipeline it is finished from there
+        bool handed_off{ false };
+
+        AtScopeExit finish_work{
+            [&]()
+            {
+                if (!handed_off)
+                {
+                    CompleteCropWork(card_name);
+                }
+            }
+        };
+
         try
         {
+            BuildDuplicates();
+
             std::shared_lock lock{ m_PropertyMutex };
+            const uint64_t generation{ m_CropGeneration.load(std::memory_order_relaxed) };
             const Length bleed_edge{ m_Data.m_BleedEdge };
             const PixelDensity max_density{ m_Cfg.m_MaxDPI };
 
@@ -442,15 +921,24 @@ bool Cropper::DoCropWork(T* signaller)
 
             const std::string color_cube_name{ m_Cfg.m_ColorCube };
 
+            const std::optional<CropStore> crop_store{
+                m_Cfg.m_ContentAddressedCrops && !m_CropStoreUnsupported.load(std::memory_order_relaxed)
+                    ? std::optional{ CropStore{ m_Data.m_CropDir } }
+                    : std::nullopt,
+            };
+
             const fs::path output_dir{ GetOutputDir(m_Data.m_CropDir, m_Data.m_BleedEdge, m_Cfg.m_ColorCube) };
 
             const fs::path input_file{ m_Data.m_ImageDir / card_name };
             const fs::path crop_file{ m_Data.m_CropDir / card_name };
             const fs::path output_file{ output_dir / card_name };
+            const fs::path image_dir{ m_Data.m_ImageDir };
             lock.unlock();
 
+            const fs::path canonical_name{ CanonicalCard(card_name) };
+
             const bool do_color_correction{ color_cube_name != "None" };
-            const cv::Mat* color_cube{ m_GetColorCube(color_cube_name) };
+            const ColorCube* color_cube{ m_GetColorCube(color_cube_name) };
 
             ImageParameters image_params{
                 .m_DPI{ max_density },
@@ -490,7 +978,10 @@ bool Cropper::DoCropWork(T* signaller)
             AtScopeExit update_progress{
                 [&]()
                 {
-                    signaller->CropProgress(progress);
+                    if (!handed_off)
+                    {
+                        signaller->CropProgress(progress);
+                    }
                 }
             };
 
@@ -498,18 +989,19 @@ bool Cropper::DoCropWork(T* signaller)
             {
                 // Only uncrop if there is no input-file or the input-file has
                 // previously been written by us
-                if (!fs::exists(input_file) || m_ImageDB.FindEntry(input_file))
+                const bool has_entry{ m_ImageDB.FindEntry(input_file) };
+                if (!fs::exists(input_file) || has_entry)
                 {
-                    QByteArray crop_file_hash{
+                    std::optional<SourceVersion> crop_file_version{
                         [&, this]()
                         {
-                            std::shared_lock image_db_lock{ m_ImageDBMutex };
+                            MetricsRegistry::ScopedTimer timer{ m_Metrics, "crop.hash" };
                             return m_ImageDB.TestEntry(input_file, crop_file, image_params);
                         }()
                     };
 
-                    // non-empty hash indicates that the source has changed
-                    if (!crop_file_hash.isEmpty())
+                    // a source version indicates that the source has changed
+                    if (crop_file_version.has_value())
                     {
                         const auto handle_ignore{
                             [&, crop_file]
@@ -519,8 +1011,7 @@ bool Cropper::DoCropWork(T* signaller)
                                     // we just wrote to this file, ignore the change and write to DB
                                     discard_ignore_notifications.push_back(crop_file);
 
-                                    std::unique_lock image_db_lock{ m_ImageDBMutex };
-                                    m_ImageDB.PutEntry(input_file, std::move(crop_file_hash), image_params);
+                                    m_ImageDB.PutEntry(input_file, std::move(crop_file_version).value(), image_params);
                                     return true;
                                 }
                                 else
@@ -534,36 +1025,122 @@ bool Cropper::DoCropWork(T* signaller)
 
                         if (!handle_ignore())
                         {
-                            const Image image{ Image::Read(crop_file) };
+                            MetricsRegistry::ScopedTimer timer{ m_Metrics, "crop.uncrop" };
+                            const Image image{ m_ImageCache.Read(crop_file) };
                             const Image uncropped_image{ UncropImage(image, card_name, card_size, fancy_uncrop) };
-                            uncropped_image.Write(input_file, 3, 95, card_size_with_full_bleed);
+                            uncropped_image.Write(input_file, m_Cfg.m_CropPngCompression, 95, card_size_with_full_bleed);
 
-                            std::unique_lock image_db_lock{ m_ImageDBMutex };
-                            m_ImageDB.PutEntry(input_file, std::move(crop_file_hash), image_params);
+                            m_ImageDB.PutEntry(input_file, std::move(crop_file_version).value(), image_params);
                         }
                     }
                 }
             }
 
-            QByteArray input_file_hash{
-                [&, this]()
+            // Whatever is read for hashing is handed to the pipeline for decoding, so a cold crop reads its source only once
+            std::optional<SourceFile> input_source{ OpenSource(image_dir, card_name) };
+            std::optional<SourceVersion> input_file_version{
+                [&, this]() -> std::optional<SourceVersion>
                 {
-                    std::shared_lock image_db_lock{ m_ImageDBMutex };
-                    return m_ImageDB.TestEntry(output_file, input_file, image_params);
+                    if (!input_source.has_value())
+                    {
+                        return std::nullopt;
+                    }
+
+                    MetricsRegistry::ScopedTimer timer{ m_Metrics, "crop.hash" };
+                    return m_ImageDB.TestEntry(output_file, input_source.value(), image_params);
                 }()
             };
 
-            // empty hash indicates that the source has not changed
-            if (input_file_hash.isEmpty())
+            if (canonical_name != card_name)
+            {
+                // Without the canonical source or output there is nothing to take over, so this card is cropped by itself
+                const fs::path canonical_output{ output_dir / canonical_name };
+                std::optional<SourceFile> canonical_source{ OpenSource(image_dir, canonical_name) };
+                if (canonical_source.has_value())
+                {
+                    const bool canonical_up_to_date{
+                        [&, this]()
+                        {
+                            MetricsRegistry::ScopedTimer timer{ m_Metrics, "crop.hash" };
+                            return !m_ImageDB.TestEntry(canonical_output, canonical_source.value(), image_params).has_value();
+                        }()
+                    };
+
+                    if (!canonical_up_to_date)
+                    {
+                        // Let the canonical card do the work, it pushes all its duplicates once it is done
+                        if (input_file_version.has_value())
+                        {
+                            PushWork(canonical_name, true, false);
+                        }
+                        return true;
+                    }
+
+                    std::error_code error_code;
+                    const auto canonical_write_time{ fs::last_write_time(canonical_output, error_code) };
+                    if (!error_code)
+                    {
+                        // Near duplicates don't change their source when the canonical card changes, so check the timestamps too
+                        const auto output_write_time{ fs::last_write_time(output_file, error_code) };
+                        if (!input_file_version.has_value() && !error_code && output_write_time >= canonical_write_time)
+                        {
+                            return true;
+                        }
+
+                        const bool copied{
+                            [&, this]()
+                            {
+                                MetricsRegistry::ScopedTimer timer{ m_Metrics, "crop.copy" };
+                                if (crop_store.has_value())
+                                {
+                                    return CropStore::Link(canonical_output, output_file);
+                                }
+
+                                // Replace rather than overwrite, the previous output may be a hard link into the crop store
+                                std::error_code copy_error_code;
+                                fs::remove(output_file, copy_error_code);
+                                return fs::copy_file(canonical_output, output_file, copy_error_code) && !copy_error_code;
+                            }()
+                        };
+                        if (copied)
+                        {
+                            m_Metrics.AddCount("crop.jobs.deduplicated");
+
+                            if (input_file_version.has_value())
+                            {
+                                m_ImageDB.PutEntry(output_file, std::move(input_file_version).value(), image_params);
+                            }
+                            return true;
+                        }
+
+                        // The previous output may be gone already, so crop this card by itself even if it was up to date
+                        if (!input_file_version.has_value() && input_source.has_value())
+                        {
+                            input_file_version = SourceVersion{
+                                .m_Hash{ input_source->Hash() },
+                                .m_Stat{ input_source->Stat() },
+                            };
+                        }
+                    }
+                }
+            }
+
+            // no source version indicates that the source has not changed
+            if (!input_file_version.has_value())
             {
                 return true;
             }
 
+            bool cancelled{ false };
             AtScopeExit write_to_db{
                 [&]()
                 {
-                    std::unique_lock image_db_lock{ m_ImageDBMutex };
-                    m_ImageDB.PutEntry(output_file, std::move(input_file_hash), image_params);
+                    if (cancelled || handed_off || !input_file_version.has_value())
+                    {
+                        return;
+                    }
+
+                    m_ImageDB.PutEntry(output_file, std::move(input_file_version).value(), image_params);
                 }
             };
 
@@ -579,29 +1156,122 @@ bool Cropper::DoCropWork(T* signaller)
                 new_ignore_notifications.push_back(crop_file);
             }
 
-            const Image image{ Image::Read(input_file) };
-            const Image cropped_image{ CropImage(image, card_name, card_size, full_bleed_edge, bleed_edge, max_density) };
-            if (do_color_correction)
+            // Parameters changed while we were working, the result would be stale anyways
+            if (m_CropGeneration.load(std::memory_order_relaxed) != generation)
             {
-                const Image vibrant_image{ cropped_image.ApplyColorCube(*color_cube) };
-                vibrant_image.Write(output_file, 3, 95, card_size_with_bleed);
+                // Nothing will be written, so don't expect a notification
+                std::erase(new_ignore_notifications, crop_file);
+                cancelled = true;
+                return true;
             }
-            else
+
+            // Identical art was cropped with the same parameters before, link to that instead of cropping again
+            const std::string store_key{
+                crop_store.has_value()
+                    ? CropStore::Key(input_file_version->m_Hash, image_params, bleed_edge, color_cube_name, output_file.extension())
+                    : std::string{},
+            };
+            if (crop_store.has_value())
             {
-                cropped_image.Write(output_file, 3, 95, card_size_with_bleed);
+                MetricsRegistry::ScopedTimer timer{ m_Metrics, "crop.store" };
+                if (crop_store->Fetch(store_key, output_file))
+                {
+                    m_Metrics.AddCount("crop.jobs.stored");
+
+                    // Put before pushing duplicates, so they find this crop up to date
+                    m_ImageDB.PutEntry(output_file, std::move(input_file_version).value(), image_params);
+                    input_file_version.reset();
+
+                    for (const fs::path& duplicate_name : DuplicateCards(card_name))
+                    {
+                        PushWork(duplicate_name, true, false);
+                    }
+                    return true;
+                }
             }
 
+            const bool expects_notification{ std::ranges::contains(new_ignore_notifications, crop_file) };
+            auto crop_job{ std::make_unique<CropJob>(CropJob{
+                .m_CardName{ card_name },
+                .m_InputFile{ input_file },
+                .m_Source{ std::move(input_source) },
+                .m_OutputFile{ output_file },
+                .m_CardSize{ card_size },
+                .m_FullBleedEdge{ full_bleed_edge },
+                .m_BleedEdge{ bleed_edge },
+                .m_MaxDensity{ max_density },
+                .m_CardSizeWithBleed{ card_size_with_bleed },
+                .m_ColorCube = do_color_correction ? color_cube : nullptr,
+                .m_IsCancelled{
+                    [this, generation]()
+                    {
+                        return m_CropGeneration.load(std::memory_order_relaxed) != generation;
+                    },
+                },
+                .m_OnDone{
+                    [=, this, input_file_version{ std::move(input_file_version).value() }](CropJobResult result) mutable
+                    {
+                        switch (result)
+                        {
+                        case CropJobResult::Success:
+                        {
+                            m_Metrics.AddCount("crop.jobs.done");
+
+                            if (crop_store.has_value() && !crop_store->Put(store_key, output_file))
+                            {
+                                // Copies in the store would be pruned right away, so don't store anything at all
+                                if (!m_CropStoreUnsupported.exchange(true, std::memory_order_relaxed))
+                                {
+                                    LogInfo("Crop folder does not support hard links, turning off the crop store");
+                                }
+                            }
+
+                            m_ImageDB.PutEntry(output_file, std::move(input_file_version), image_params);
+
+                            // Duplicates are waiting for this crop to be done so they can take it over
+                            for (const fs::path& duplicate_name : DuplicateCards(card_name))
+                            {
+                                PushWork(duplicate_name, true, false);
+                            }
+                            break;
+                        }
+                        case CropJobResult::Failed:
+                        {
+                            m_Metrics.AddCount("crop.jobs.failed");
+
+                            // Same as failing before handing off
+                            RetryCropWork(card_name);
+                            break;
+                        }
+                        case CropJobResult::Cancelled:
+                            m_Metrics.AddCount("crop.jobs.cancelled");
+                            break;
+                        }
+
+                        if (result != CropJobResult::Success && expects_notification)
+                        {
+                            std::lock_guard ignore_lock{ m_IgnoreMutex };
+                            std::erase(m_IgnoreNotification, crop_file);
+                        }
+
+                        signaller->CropProgress(progress);
+                        CompleteCropWork(card_name);
+                    },
+                },
+            }) };
+
+            // From here on the pipeline owns finishing this work, submitting blocks while
+            // the pipeline is full, which keeps this worker from running ahead of it
+            handed_off = true;
+            m_CropPipeline->Submit(std::move(crop_job));
+
             return true;
         }
         catch (...)
         {
             // If user updated the file we may be reading it's still being written to,
-            // Hopefully that's the only reason to end up here...
-            std::lock_guard lock{ m_PendingCropWorkMutex };
-            if (!std::ranges::contains(m_PendingCropWork, card_name))
-            {
-                m_PendingCropWork.push_back(std::move(card_name));
-            }
+            // Hopefully that's the only reason to end up here, so give it a moment...
+            RetryCropWork(card_name);
 
             // We have failed, but we tried doing work, so we return true
             return true;
@@ -615,16 +1285,28 @@ template<class T>
 bool Cropper::DoPreviewWork(T* signaller)
 {
     auto pop_work{
-        [this]() -> std::optional<fs::path>
+        [this, signaller]() -> std::optional<fs::path>
         {
-            std::lock_guard lock{ m_PendingPreviewWorkMutex };
-            if (m_PendingPreviewWork.empty())
+            fs::path first_work_to_do;
+            {
+                std::lock_guard lock{ m_PendingPreviewWorkMutex };
+                auto next_work{ m_PendingPreviewWork.Pop() };
+                if (!next_work.has_value())
+                {
+                    return std::nullopt;
+                }
+
+                first_work_to_do = std::move(next_work).value();
+                m_PreviewWorkInFlight.insert(first_work_to_do);
+                m_Metrics.SetGauge("queue.preview.pending", static_cast<double>(m_PendingPreviewWork.Size()));
+            }
+
+            m_PreviewsInFlight.fetch_add(1, std::memory_order_relaxed);
+            if (!m_PreviewWorking.exchange(true, std::memory_order_relaxed))
             {
-                return std::nullopt;
+                signaller->PreviewWorkStart();
             }
 
-            fs::path first_work_to_do{ std::move(m_PendingPreviewWork.front()) };
-            m_PendingPreviewWork.erase(m_PendingPreviewWork.begin());
             return first_work_to_do;
         },
     };
@@ -633,6 +1315,15 @@ bool Cropper::DoPreviewWork(T* signaller)
     {
         fs::path card_name{ std::move(preview_work_to_do).value() };
 
+        AtScopeExit finish_work{
+            [&]()
+            {
+                FinishPreviewWork(card_name);
+                m_LastPreviewWorkPoint.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+                m_PreviewsInFlight.fetch_sub(1, std::memory_order_relaxed);
+            }
+        };
+
         try
         {
             std::shared_lock lock{ m_PropertyMutex };
@@ -645,6 +1336,7 @@ bool Cropper::DoPreviewWork(T* signaller)
             const bool enable_uncrop{ m_Cfg.m_EnableUncrop };
             const bool fancy_uncrop{ m_Cfg.m_EnableFancyUncrop };
 
+            const fs::path image_dir{ m_Data.m_ImageDir };
             const fs::path input_file{ m_Data.m_ImageDir / card_name };
             const fs::path crop_file{ m_Data.m_CropDir / card_name };
 
@@ -664,45 +1356,108 @@ bool Cropper::DoPreviewWork(T* signaller)
             // Generate Preview ...
             if (fs::exists(input_file))
             {
-                QByteArray input_file_hash{
-                    [&, this]()
+                std::optional<SourceVersion> input_file_version{
+                    [&, this]() -> std::optional<SourceVersion>
                     {
-                        std::shared_lock image_db_lock{ m_ImageDBMutex };
-                        return m_ImageDB.TestEntry(output_file, input_file, image_params);
+                        std::optional<SourceFile> input_source{ OpenSource(image_dir, card_name) };
+                        if (!input_source.has_value())
+                        {
+                            return std::nullopt;
+                        }
+
+                        MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.hash" };
+                        return m_ImageDB.TestEntry(output_file, input_source.value(), image_params);
                     }()
                 };
 
-                // empty hash indicates that the source has not changed
-                if (input_file_hash.isEmpty() && has_preview)
+                // no source version indicates that the source has not changed
+                if (!input_file_version.has_value() && has_preview)
                 {
                     return true;
                 }
 
-                const Image image{ Image::Read(input_file).Resize(uncropped_size) };
-
-                ImagePreview image_preview{};
-                image_preview.m_UncroppedImage = image;
-                image_preview.m_CroppedImage = CropImage(image, card_name, card_size, full_bleed_edge, 0_mm, 1200_dpi);
+                // Duplicates share a single preview, as long as the canonical content didn't change since it was made
+                const fs::path canonical_name{ CanonicalCard(card_name) };
+                const QByteArray shared_content_hash{ SharedContentHash(canonical_name) };
+                const std::optional<ImagePreview> shared_preview{
+                    [&, this]() -> std::optional<ImagePreview>
+                    {
+                        if (shared_content_hash.isEmpty())
+                        {
+                            return std::nullopt;
+                        }
 
+                        std::lock_guard shared_previews_lock{ m_SharedPreviewsMutex };
+                        const auto it{ m_SharedPreviews.find(canonical_name) };
+                        if (it == m_SharedPreviews.end() || it->second.m_ContentHash != shared_content_hash)
+                        {
+                            return std::nullopt;
+                        }
+                        return it->second.m_Preview;
+                    }()
+                };
+                if (shared_preview.has_value())
                 {
-                    std::unique_lock image_db_lock{ m_ImageDBMutex };
-                    m_ImageDB.PutEntry(output_file, std::move(input_file_hash), image_params);
+                    if (input_file_version.has_value())
+                    {
+                        m_ImageDB.PutEntry(output_file, std::move(input_file_version).value(), image_params);
+                    }
+
+                    signaller->PreviewUpdated(card_name, shared_preview.value());
+                    m_Metrics.AddCount("preview.jobs.deduplicated");
                 }
+                else
+                {
+                    // Reuse a full decode if the crop work already has one, otherwise decode at reduced resolution
+                    Image image{ m_ImageCache.Find(input_file) };
+                    if (image.Valid())
+                    {
+                        MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.resize" };
+                        image = image.Resize(uncropped_size);
+                    }
+                    else
+                    {
+                        MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.read" };
+                        image = Image::ReadScaled(input_file, uncropped_size);
+                    }
 
-                signaller->PreviewUpdated(card_name, image_preview);
+                    ImagePreview image_preview{};
+                    image_preview.m_UncroppedImage = image;
+                    {
+                        MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.crop" };
+                        image_preview.m_CroppedImage = CropImage(image, card_name, card_size, full_bleed_edge, 0_mm, 1200_dpi);
+                    }
+
+                    if (input_file_version.has_value())
+                    {
+                        m_ImageDB.PutEntry(output_file, std::move(input_file_version).value(), image_params);
+                    }
+
+                    if (!shared_content_hash.isEmpty())
+                    {
+                        std::lock_guard shared_previews_lock{ m_SharedPreviewsMutex };
+                        m_SharedPreviews[canonical_name] = SharedPreview{
+                            .m_ContentHash{ shared_content_hash },
+                            .m_Preview{ image_preview },
+                        };
+                    }
+
+                    signaller->PreviewUpdated(card_name, image_preview);
+                    m_Metrics.AddCount("preview.jobs");
+                }
             }
             else if (enable_uncrop && fs::exists(crop_file))
             {
-                QByteArray crop_file_hash{
+                std::optional<SourceVersion> crop_file_version{
                     [&, this]()
                     {
-                        std::shared_lock image_db_lock{ m_ImageDBMutex };
+                        MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.hash" };
                         return m_ImageDB.TestEntry(output_file, crop_file, image_params);
                     }()
                 };
 
-                // empty hash indicates that the source has not changed
-                if (crop_file_hash.isEmpty() && has_preview)
+                // no source version indicates that the source has not changed
+                if (!crop_file_version.has_value() && has_preview)
                 {
                     return true;
                 }
@@ -718,30 +1473,45 @@ bool Cropper::DoPreviewWork(T* signaller)
                     }()
                 };
 
-                const Image image{ Image::Read(crop_file).Resize(cropped_size) };
+                // Reuse a full decode if the crop work already has one, otherwise decode at reduced resolution
+                Image image{ m_ImageCache.Find(crop_file) };
+                if (image.Valid())
+                {
+                    MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.resize" };
+                    image = image.Resize(cropped_size);
+                }
+                else
+                {
+                    MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.read" };
+                    image = Image::ReadScaled(crop_file, cropped_size);
+                }
 
                 ImagePreview image_preview{};
                 image_preview.m_CroppedImage = image;
-                image_preview.m_UncroppedImage = UncropImage(image, card_name, card_size, fancy_uncrop);
+                {
+                    MetricsRegistry::ScopedTimer timer{ m_Metrics, "preview.uncrop" };
+                    image_preview.m_UncroppedImage = UncropImage(image, card_name, card_size, fancy_uncrop);
+                }
 
                 signaller->PreviewUpdated(card_name, image_preview);
+                m_Metrics.AddCount("preview.jobs");
             }
 
             if (!has_preview)
             {
-                m_LoadedPreviews.push_back(card_name);
+                std::unique_lock property_lock{ m_PropertyMutex };
+                if (!std::ranges::contains(m_LoadedPreviews, card_name))
+                {
+                    m_LoadedPreviews.push_back(card_name);
+                }
             }
             return true;
         }
         catch (...)
         {
             // If user updated the file we may be reading it's still being written to,
-            // Hopefully that's the only reason to end up here...
-            std::lock_guard lock{ m_PendingPreviewWorkMutex };
-            if (!std::ranges::contains(m_PendingPreviewWork, card_name))
-            {
-                m_PendingPreviewWork.push_back(std::move(card_name));
-            }
+            // Hopefully that's the only reason to end up here, so give it a moment...
+            RetryPreviewWork(card_name);
 
             // We have failed, but we tried doing work, so we return true
             return true;
@@ -0,0 +1,157 @@
+#include <ppp/project/decoded_image_cache.hpp>
+
+#include <opencv2/core/mat.hpp>
+
+DecodedImageCache::DecodedImageCache(size_t budget_bytes)
+    : m_BudgetBytes{ budget_bytes }
+{
+}
+
+Image DecodedImageCache::Read(const fs::path& path)
+{
+    return Read(path, nullptr);
+}
+
+Image DecodedImageCache::Read(SourceFile& source)
+{
+    return Read(source.Path(), &source);
+}
+
+Image DecodedImageCache::Read(const fs::path& path, SourceFile* source)
+{
+    const auto decode{
+        [&]()
+        {
+            return source != nullptr ? source->Decode() : Image::Read(path);
+        }
+    };
+
+    std::error_code error_code;
+    const fs::file_time_type write_time{ fs::last_write_time(path, error_code) };
+    if (error_code)
+    {
+        m_Misses.fetch_add(1, std::memory_order_relaxed);
+        return decode();
+    }
+
+    {
+        std::lock_guard lock{ m_Mutex };
+        if (const auto it{ m_Index.find(path) }; it != m_Index.end())
+        {
+            const auto entry_it{ it->second };
+            if (entry_it->m_WriteTime == write_time)
+            {
+                m_Entries.splice(m_Entries.begin(), m_Entries, entry_it);
+                m_Hits.fetch_add(1, std::memory_order_relaxed);
+                return Image{ entry_it->m_Image };
+            }
+
+            m_Bytes -= entry_it->m_Bytes;
+            m_Entries.erase(entry_it);
+            m_Index.erase(it);
+        }
+    }
+
+    // Decode without holding the lock, if two threads race on the same file both decode and the last one wins
+    m_Misses.fetch_add(1, std::memory_order_relaxed);
+    Image image{ decode() };
+    if (!image.Valid())
+    {
+        return image;
+    }
+
+    const cv::Mat& mat{ image.GetUnderlying() };
+    const size_t bytes{ mat.total() * mat.elemSize() };
+
+    std::lock_guard lock{ m_Mutex };
+    if (bytes > m_BudgetBytes)
+    {
+        return image;
+    }
+
+    if (const auto it{ m_Index.find(path) }; it != m_Index.end())
+    {
+        m_Bytes -= it->second->m_Bytes;
+        m_Entries.erase(it->second);
+        m_Index.erase(it);
+    }
+
+    m_Entries.push_front(Entry{
+        .m_Path{ path },
+        .m_WriteTime{ write_time },
+        .m_Image{ mat },
+        .m_Bytes = bytes,
+    });
+    m_Index.emplace(path, m_Entries.begin());
+    m_Bytes += bytes;
+    EvictToBudget();
+
+    return image;
+}
+
+Image DecodedImageCache::Find(const fs::path& path)
+{
+    std::error_code error_code;
+    const fs::file_time_type write_time{ fs::last_write_time(path, error_code) };
+    if (error_code)
+    {
+        return Image{};
+    }
+
+    std::lock_guard lock{ m_Mutex };
+    if (const auto it{ m_Index.find(path) }; it != m_Index.end() && it->second->m_WriteTime == write_time)
+    {
+        m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+        m_Hits.fetch_add(1, std::memory_order_relaxed);
+        return Image{ it->second->m_Image };
+    }
+    return Image{};
+}
+
+void DecodedImageCache::Erase(const fs::path& path)
+{
+    std::lock_guard lock{ m_Mutex };
+    if (const auto it{ m_Index.find(path) }; it != m_Index.end())
+    {
+        m_Bytes -= it->second->m_Bytes;
+        m_Entries.erase(it->second);
+        m_Index.erase(it);
+    }
+}
+
+void DecodedImageCache::Clear()
+{
+    std::lock_guard lock{ m_Mutex };
+    m_Entries.clear();
+    m_Index.clear();
+    m_Bytes = 0;
+}
+
+void DecodedImageCache::SetBudget(size_t budget_bytes)
+{
+    std::lock_guard lock{ m_Mutex };
+    m_BudgetBytes = budget_bytes;
+    EvictToBudget();
+}
+
+DecodedImageCache::Stats DecodedImageCache::TakeStats()
+{
+    std::lock_guard lock{ m_Mutex };
+    return Stats{
+        .m_Hits = m_Hits.exchange(0, std::memory_order_relaxed),
+        .m_Misses = m_Misses.exchange(0, std::memory_order_relaxed),
+        .m_Entries = m_Entries.size(),
+        .m_Bytes = m_Bytes,
+    };
+}
+
+void DecodedImageCache::EvictToBudget()
+{
+    while (m_Bytes > m_BudgetBytes && !m_Entries.empty())
+    {
+        const Entry& oldest{ m_Entries.back() };
+        m_Bytes -= oldest.m_Bytes;
+        m_Index.erase(oldest.m_Path);
+        m_Entries.pop_back();
+    }
+}
@@ -0,0 +1,359 @@
+#include <ppp/project/duplicate_index.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <ranges>
+#include <unordered_set>
+
+#include <QImageReader>
+
+#include <opencv2/core.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <ppp/image.hpp>
+#include <ppp/qt_util.hpp>
+#include <ppp/version.hpp>
+
+#include <ppp/project/image_ops.hpp>
+
+// NOLINTNEXTLINE
+void from_json(const nlohmann::json& json, DuplicateIndexEntry& entry)
+{
+    const auto& hash{ json["content"]["bytes"].get<std::vector<uint8_t>>() };
+    entry.m_ContentHash = QByteArray{
+        reinterpret_cast<const char*>(hash.data()),
+        static_cast<qsizetype>(hash.size()),
+    };
+    entry.m_Stat.m_Size = json["size"].get<uintmax_t>();
+    entry.m_Stat.m_WriteTime = json["time"].get<int64_t>();
+    entry.m_Stat.m_Inode = json["inode"].get<uint64_t>();
+    entry.m_PerceptualHash = json["phash"].get<uint64_t>();
+    entry.m_Width = json["width"].get<int32_t>();
+    entry.m_Height = json["height"].get<int32_t>();
+}
+
+// NOLINTNEXTLINE
+void to_json(nlohmann::json& json, const DuplicateIndexEntry& entry)
+{
+    json["content"] = nlohmann::json::binary_t{
+        std::vector<uint8_t>{
+            entry.m_ContentHash.begin(),
+            entry.m_ContentHash.end(),
+        },
+    };
+    json["size"] = entry.m_Stat.m_Size;
+    json["time"] = entry.m_Stat.m_WriteTime;
+    json["inode"] = entry.m_Stat.m_Inode;
+    json["phash"] = entry.m_PerceptualHash;
+    json["width"] = entry.m_Width;
+    json["height"] = entry.m_Height;
+}
+
+static std::optional<DuplicateIndexEntry> HashImage(const fs::path& path)
+{
+    const std::optional<FileStat> stat{ StatFile(path) };
+    if (!stat.has_value())
+    {
+        return std::nullopt;
+    }
+
+    QByteArray content_hash{ HashFile(path) };
+    if (content_hash.isEmpty())
+    {
+        return std::nullopt;
+    }
+
+    const QSize size{ QImageReader{ ToQString(path) }.size() };
+
+    try
+    {
+        // The perceptual hash only looks at a 32x32 version of the image, so decode at reduced resolution
+        const Image thumbnail{ Image::ReadScaled(path, { 32_pix, 32_pix }) };
+        if (!thumbnail.Valid())
+        {
+            return std::nullopt;
+        }
+
+        return DuplicateIndexEntry{
+            .m_Stat{ stat.value() },
+            .m_ContentHash{ std::move(content_hash) },
+            .m_PerceptualHash = thumbnail.Hash(),
+            .m_Width = size.width(),
+            .m_Height = size.height(),
+        };
+    }
+    catch (...)
+    {
+        // Most likely the image is still being written to, it will be hashed again once it was modified
+        return std::nullopt;
+    }
+}
+
+DuplicateIndex DuplicateIndex::Build(const fs::path& image_dir, const fs::path& path, bool near_duplicates)
+{
+    const auto start_point{ std::chrono::steady_clock::now() };
+
+    DuplicateIndex previous_index{ Read(path) };
+    DuplicateIndex index{};
+    index.m_NearDuplicates = near_duplicates;
+
+    // Anything that has the same size, modification time and inode as last time is reused as is
+    std::vector<fs::path> to_hash;
+    for (fs::path& image_name : ListImageFiles(image_dir))
+    {
+        const std::optional<FileStat> stat{ StatFile(image_dir / image_name) };
+        if (!stat.has_value())
+        {
+            continue;
+        }
+
+        const auto it{ previous_index.m_Entries.find(image_name) };
+        if (it != previous_index.m_Entries.end() && it->second.m_Stat == stat.value())
+        {
+            index.m_Entries.emplace(std::move(image_name), std::move(it->second));
+        }
+        else
+        {
+            to_hash.push_back(std::move(image_name));
+        }
+    }
+
+    std::vector<std::optional<DuplicateIndexEntry>> hashed(to_hash.size());
+    cv::parallel_for_(cv::Range{ 0, static_cast<int>(to_hash.size()) },
+                      [&](const cv::Range& range)
+                      {
+                          for (int i = range.start; i < range.end; i++)
+                          {
+                              hashed[i] = HashImage(image_dir / to_hash[i]);
+                          }
+                      });
+
+    for (size_t i = 0; i < to_hash.size(); i++)
+    {
+        if (hashed[i].has_value())
+        {
+            index.m_Entries.emplace(std::move(to_hash[i]), std::move(hashed[i]).value());
+        }
+    }
+
+    index.Regroup();
+    index.m_Report.m_Hashed = to_hash.size();
+    index.m_Report.m_Duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_point);
+    return index;
+}
+
+DuplicateIndex DuplicateIndex::Read(const fs::path& path)
+{
+    DuplicateIndex index{};
+
+    try
+    {
+        if (fs::exists(path))
+        {
+            const nlohmann::json json{ nlohmann::json::parse(std::ifstream{ path }) };
+            if (!json.contains("version") || !json["version"].is_string() || json["version"].get_ref<const std::string&>() != DuplicateIndexFormatVersion())
+            {
+                throw std::logic_error{ "Duplicate index version not compatible with App version..." };
+            }
+
+            index.m_NearDuplicates = json["near_duplicates"].get<bool>();
+            for (const nlohmann::json& image : json["images"])
+            {
+                index.m_Entries.emplace(image["name"].get<fs::path>(), image["entry"].get<DuplicateIndexEntry>());
+            }
+            for (const nlohmann::json& duplicate : json["duplicates"])
+            {
+                index.m_Canonical.emplace(duplicate["name"].get<fs::path>(), duplicate["canonical"].get<fs::path>());
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print("{}", e.what());
+        // Failed loading duplicate index, continuing with an empty index...
+        index = DuplicateIndex{};
+    }
+
+    index.m_Report.m_Images = index.m_Entries.size();
+    index.m_Report.m_Duplicates = index.m_Canonical.size();
+    return index;
+}
+
+void DuplicateIndex::Write(const fs::path& path) const
+{
+    nlohmann::json images{ nlohmann::json::array() };
+    for (const auto& [image_name, entry] : m_Entries)
+    {
+        images.push_back(nlohmann::json{
+            { "name", image_name },
+            { "entry", entry },
+        });
+    }
+
+    nlohmann::json duplicates{ nlohmann::json::array() };
+    for (const auto& [image_name, canonical_name] : m_Canonical)
+    {
+        duplicates.push_back(nlohmann::json{
+            { "name", image_name },
+            { "canonical", canonical_name },
+        });
+    }
+
+    // Write to a temporary file first so a crash never leaves a torn index behind
+    const fs::path temp_path{ fs::path{ path }.concat(".tmp") };
+    if (std::ofstream file{ temp_path })
+    {
+        nlohmann::json json{};
+        json["version"] = DuplicateIndexFormatVersion();
+        json["near_duplicates"] = m_NearDuplicates;
+        json["images"] = std::move(images);
+        json["duplicates"] = std::move(duplicates);
+
+        file << json;
+        file.close();
+
+        std::error_code error_code;
+        fs::rename(temp_path, path, error_code);
+    }
+}
+
+void DuplicateIndex::Update(const fs::path& image_dir, const fs::path& image_name)
+{
+    Update(image_name, Hash(image_dir, image_name));
+}
+
+std::optional<DuplicateIndexEntry> DuplicateIndex::Hash(const fs::path& image_dir, const fs::path& image_name)
+{
+    return HashImage(image_dir / image_name);
+}
+
+void DuplicateIndex::Update(const fs::path& image_name, std::optional<DuplicateIndexEntry> entry)
+{
+    if (entry.has_value())
+    {
+        m_Entries[image_name] = std::move(entry).value();
+    }
+    else
+    {
+        m_Entries.erase(image_name);
+    }
+
+    Regroup();
+}
+
+const fs::path& DuplicateIndex::Canonical(const fs::path& image_name) const
+{
+    const auto it{ m_Canonical.find(image_name) };
+    return it != m_Canonical.end() ? it->second : image_name;
+}
+
+std::vector<fs::path> DuplicateIndex::Duplicates(const fs::path& canonical_name) const
+{
+    std::vector<fs::path> duplicates;
+    for (const auto& [image_name, canonical] : m_Canonical)
+    {
+        if (canonical == canonical_name)
+        {
+            duplicates.push_back(image_name);
+        }
+    }
+    return duplicates;
+}
+
+QByteArray DuplicateIndex::ContentHash(const fs::path& image_name) const
+{
+    const auto it{ m_Entries.find(image_name) };
+    return it != m_Entries.end() ? it->second.m_ContentHash : QByteArray{};
+}
+
+QByteArray DuplicateIndex::ContentHash(const fs::path& image_name, const FileStat& stat) const
+{
+    const auto it{ m_Entries.find(image_name) };
+    return it != m_Entries.end() && it->second.m_Stat == stat ? it->second.m_ContentHash : QByteArray{};
+}
+
+const DuplicateIndex::Report& DuplicateIndex::GetReport() const
+{
+    return m_Report;
+}
+
+void DuplicateIndex::Regroup()
+{
+    m_Canonical.clear();
+
+    // Visit images by stem length first and name second, so the first image of each group becomes its
+    // canonical image and "card.png" is preferred over copies such as "card - Copy.png" or "card (1).png"
+    std::vector<std::pair<const fs::path*, const DuplicateIndexEntry*>> sorted_entries;
+    for (const auto& [image_name, entry] : m_Entries)
+    {
+        sorted_entries.emplace_back(&image_name, &entry);
+    }
+    std::ranges::sort(sorted_entries,
+                      [](const auto& lhs, const auto& rhs)
+                      {
+                          const auto lhs_stem_length{ lhs.first->stem().native().size() };
+                          const auto rhs_stem_length{ rhs.first->stem().native().size() };
+                          if (lhs_stem_length != rhs_stem_length)
+                          {
+                              return lhs_stem_length < rhs_stem_length;
+                          }
+                          return *lhs.first < *rhs.first;
+                      });
+
+    std::map<QByteArray, const fs::path*> canonical_by_content;
+    std::vector<std::pair<const fs::path*, const DuplicateIndexEntry*>> canonical_images;
+    uintmax_t duplicate_bytes{ 0 };
+    for (const auto& [image_name, entry] : sorted_entries)
+    {
+        const fs::path* canonical{
+            [&]() -> const fs::path*
+            {
+                if (const auto it{ canonical_by_content.find(entry->m_ContentHash) }; it != canonical_by_content.end())
+                {
+                    return it->second;
+                }
+
+                if (m_NearDuplicates)
+                {
+                    const auto it{
+                        std::ranges::find_if(canonical_images,
+                                             [&](const auto& canonical_image)
+                                             {
+                                                 const DuplicateIndexEntry& canonical_entry{ *canonical_image.second };
+                                                 const auto distance{ std::popcount(canonical_entry.m_PerceptualHash ^ entry->m_PerceptualHash) };
+                                                 return canonical_entry.m_Width == entry->m_Width &&
+                                                        canonical_entry.m_Height == entry->m_Height &&
+                                                        static_cast<uint32_t>(distance) <= c_NearDuplicateDistance;
+                                             }),
+                    };
+                    if (it != canonical_images.end())
+                    {
+                        return it->first;
+                    }
+                }
+
+                return nullptr;
+            }()
+        };
+
+        if (canonical != nullptr)
+        {
+            m_Canonical.emplace(*image_name, *canonical);
+            duplicate_bytes += entry->m_Stat.m_Size;
+        }
+        else
+        {
+            canonical_by_content.emplace(entry->m_ContentHash, image_name);
+            canonical_images.emplace_back(image_name, entry);
+        }
+    }
+
+    m_Report.m_Images = m_Entries.size();
+    m_Report.m_Duplicates = m_Canonical.size();
+    m_Report.m_DuplicateBytes = duplicate_bytes;
+    m_Report.m_Groups = (m_Canonical | std::views::values | std::ranges::to<std::unordered_set>()).size();
+}
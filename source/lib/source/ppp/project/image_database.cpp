@@ -1,12 +1,16 @@
 #include <ppp/project/image_database.hpp>
 
-#include <QCryptographicHash>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
 #include <QDebug>
-#include <QFile>
 
 #include <nlohmann/json.hpp>
 
-#include <ppp/qt_util.hpp>
+#include <xxhash.h>
+
 #include <ppp/version.hpp>
 
 bool operator!=(const ImageParameters& lhs, const ImageParameters& rhs)
@@ -29,6 +33,17 @@ void from_json(const nlohmann::json& json, ImageDataBaseEntry& entry)
         reinterpret_cast<const char*>(hash.data()),
         static_cast<qsizetype>(hash.size()),
     };
+    if (json.contains("stat"))
+    {
+        entry.m_SourceStat.m_Size = json["stat"]["size"].get<uintmax_t>();
+        entry.m_SourceStat.m_WriteTime = json["stat"]["time"].get<int64_t>();
+        entry.m_SourceStat.m_Inode = json["stat"]["inode"].get<uint64_t>();
+    }
+    else
+    {
+        // Written before we stored the stat, back when sources were hashed with MD5
+        entry.m_LegacyHash = true;
+    }
     entry.m_Params.m_DPI.value = json["dpi"].get<int32_t>();
     entry.m_Params.m_Width = json["width"].get<int32_t>() * 1_pix;
     entry.m_Params.m_CardSize.x = json["card_size"]["width"].get<int32_t>() * 0.001_mm;
@@ -45,6 +60,11 @@ void to_json(nlohmann::json& json, const ImageDataBaseEntry& entry)
             entry.m_SourceHash.end(),
         },
     };
+    json["stat"] = nlohmann::json{
+        { "size", entry.m_SourceStat.m_Size },
+        { "time", entry.m_SourceStat.m_WriteTime },
+        { "inode", entry.m_SourceStat.m_Inode },
+    };
     json["dpi"] = static_cast<int32_t>(entry.m_Params.m_DPI.value),
     json["width"] = static_cast<int32_t>(entry.m_Params.m_Width.value),
     json["card_size"] = nlohmann::json{
@@ -60,91 +80,635 @@ void to_json(nlohmann::json& json, const ImageDataBaseEntry& entry)
     json["card_input_bleed"] = static_cast<int32_t>(entry.m_Params.m_FullBleedEdge / 0.001_mm);
 }
 
+// Snapshots written before the binary format, entries from these are still read and migrated,
+// PPP00002 snapshots hold MD5 hashes, their entries are marked so they never match
+static constexpr std::array c_JsonFormatVersions{
+    std::string_view{ "PPP00002" },
+    std::string_view{ "PPP00003" },
+};
+
+namespace
+{
+struct SnapshotHeader
+{
+    std::array<char, 8> m_Version;
+    uint32_t m_RecordSize;
+    uint32_t m_RecordCount;
+    // Always a power of two, each bucket holds a record index plus one or zero if empty
+    uint32_t m_BucketCount;
+    uint32_t m_Padding;
+    uint64_t m_PathPoolSize;
+};
+static_assert(sizeof(SnapshotHeader) == 32);
+
+// Lengths are stored in micrometers, the same resolution ImageParameters are compared at
+struct SnapshotRecord
+{
+    uint64_t m_PathHash;
+    uint64_t m_PathOffset;
+    uint32_t m_PathSize;
+    uint32_t m_SourceHashSize;
+    std::array<uint8_t, 16> m_SourceHash;
+    uint64_t m_SourceSize;
+    int64_t m_SourceWriteTime;
+    uint64_t m_SourceInode;
+    int32_t m_DPI;
+    int32_t m_Width;
+    int32_t m_CardWidth;
+    int32_t m_CardHeight;
+    int32_t m_FullBleedEdge;
+    uint32_t m_Flags;
+};
+static_assert(sizeof(SnapshotRecord) == 88);
+
+static constexpr uint32_t c_LegacyHashFlag{ 1 << 0 };
+static_assert(std::is_trivially_copyable_v<SnapshotRecord>);
+
+std::string_view PathKey(const std::u8string& path)
+{
+    return std::string_view{ reinterpret_cast<const char*>(path.data()), path.size() };
+}
+
+uint64_t HashPathKey(std::string_view path_key)
+{
+    return XXH3_64bits(path_key.data(), path_key.size());
+}
+
+template<class T>
+T ReadAt(std::span<const std::byte> bytes, size_t offset)
+{
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+size_t BucketsOffset()
+{
+    return sizeof(SnapshotHeader);
+}
+
+size_t RecordsOffset(const SnapshotHeader& header)
+{
+    return BucketsOffset() + size_t{ header.m_BucketCount } * sizeof(uint32_t);
+}
+
+size_t PathPoolOffset(const SnapshotHeader& header)
+{
+    return RecordsOffset(header) + size_t{ header.m_RecordCount } * sizeof(SnapshotRecord);
+}
+
+SnapshotRecord ToRecord(const ImageDataBaseEntry& entry)
+{
+    SnapshotRecord record{};
+    record.m_SourceHashSize = static_cast<uint32_t>(std::min(static_cast<size_t>(entry.m_SourceHash.size()), record.m_SourceHash.size()));
+    std::memcpy(record.m_SourceHash.data(), entry.m_SourceHash.data(), record.m_SourceHashSize);
+    record.m_SourceSize = entry.m_SourceStat.m_Size;
+    record.m_SourceWriteTime = entry.m_SourceStat.m_WriteTime;
+    record.m_SourceInode = entry.m_SourceStat.m_Inode;
+    record.m_DPI = static_cast<int32_t>(entry.m_Params.m_DPI.value);
+    record.m_Width = static_cast<int32_t>(entry.m_Params.m_Width.value);
+    record.m_CardWidth = static_cast<int32_t>(entry.m_Params.m_CardSize.x / 0.001_mm);
+    record.m_CardHeight = static_cast<int32_t>(entry.m_Params.m_CardSize.y / 0.001_mm);
+    record.m_FullBleedEdge = static_cast<int32_t>(entry.m_Params.m_FullBleedEdge / 0.001_mm);
+    record.m_Flags = entry.m_LegacyHash ? c_LegacyHashFlag : 0;
+    return record;
+}
+
+ImageDataBaseEntry FromRecord(const SnapshotRecord& record)
+{
+    ImageDataBaseEntry entry{};
+    entry.m_SourceHash = QByteArray{
+        reinterpret_cast<const char*>(record.m_SourceHash.data()),
+        static_cast<qsizetype>(std::min(size_t{ record.m_SourceHashSize }, record.m_SourceHash.size())),
+    };
+    entry.m_SourceStat.m_Size = record.m_SourceSize;
+    entry.m_SourceStat.m_WriteTime = record.m_SourceWriteTime;
+    entry.m_SourceStat.m_Inode = record.m_SourceInode;
+    entry.m_Params.m_DPI.value = static_cast<float>(record.m_DPI);
+    entry.m_Params.m_Width = record.m_Width * 1_pix;
+    entry.m_Params.m_CardSize.x = record.m_CardWidth * 0.001_mm;
+    entry.m_Params.m_CardSize.y = record.m_CardHeight * 0.001_mm;
+    entry.m_Params.m_FullBleedEdge = record.m_FullBleedEdge * 0.001_mm;
+    entry.m_LegacyHash = (record.m_Flags & c_LegacyHashFlag) != 0;
+    return entry;
+}
+} // namespace
+
+static fs::path JournalPath(const fs::path& path)
+{
+    return fs::path{ path }.concat(".journal");
+}
+
 ImageDataBase ImageDataBase::Read(const fs::path& path)
 {
-    try
+    return ImageDataBase{ path };
+}
+
+ImageDataBase::ImageDataBase(const fs::path& path)
+{
+    // Nobody else can see this database yet, no need to lock
+    ResetLocked(path);
+}
+
+ImageDataBase::~ImageDataBase()
+{
+    FlushJournalLocked();
+}
+
+void ImageDataBase::Reset(const fs::path& path)
+{
+    std::unique_lock lock{ m_SnapshotMutex };
+    ResetLocked(path);
+}
+
+void ImageDataBase::Write(const fs::path& path)
+{
+    std::unique_lock lock{ m_SnapshotMutex };
+    WriteLocked(path);
+}
+
+void ImageDataBase::ResetLocked(const fs::path& path)
+{
+    // Whatever was put into the previous database still belongs into its journal
+    FlushJournalLocked();
+
+    m_Snapshot.reset();
+    ClearOverlay();
+
+    bool migrated{ false };
+    if (fs::exists(path) && !MapSnapshot(path))
     {
-        const nlohmann::json json{ nlohmann::json::parse(std::ifstream{ path }) };
-        if (!json.contains("version") || !json["version"].is_string() || json["version"].get_ref<const std::string&>() != ImageDbFormatVersion())
+        migrated = ReadJsonSnapshot(path);
+    }
+
+    m_Path = path;
+    if (ReplayJournal(JournalPath(path)) || migrated)
+    {
+        // We were not shut down cleanly or the snapshot is in an old format, fold everything into a new snapshot right away
+        WriteLocked(path);
+    }
+    else
+    {
+        OpenJournal(JournalPath(path));
+    }
+}
+
+void ImageDataBase::WriteLocked(const fs::path& path)
+{
+    // Collect everything from the snapshot that wasn't put again since and everything that was
+    std::vector<SnapshotRecord> records;
+    std::string path_pool;
+    const auto add_record{
+        [&](SnapshotRecord record, std::string_view path_key)
         {
-            throw std::logic_error{ "Image databse version not compatible with App version..." };
+            record.m_PathHash = HashPathKey(path_key);
+            record.m_PathOffset = path_pool.size();
+            record.m_PathSize = static_cast<uint32_t>(path_key.size());
+            path_pool.append(path_key);
+            records.push_back(record);
         }
+    };
 
-        ImageDataBase image_db{};
-        image_db.m_DataBase = json["db"].get<decltype(image_db.m_DataBase)>();
-        return image_db;
+    if (m_Snapshot.has_value())
+    {
+        const std::span<const std::byte> bytes{ m_Snapshot->Bytes() };
+        const auto header{ ReadAt<SnapshotHeader>(bytes, 0) };
+        const size_t path_pool_offset{ PathPoolOffset(header) };
+        for (uint32_t i = 0; i < header.m_RecordCount; i++)
+        {
+            const auto record{ ReadAt<SnapshotRecord>(bytes, RecordsOffset(header) + i * sizeof(SnapshotRecord)) };
+            const std::string_view path_key{
+                reinterpret_cast<const char*>(bytes.data() + path_pool_offset + record.m_PathOffset),
+                record.m_PathSize,
+            };
+            const std::u8string_view path_u8{ reinterpret_cast<const char8_t*>(path_key.data()), path_key.size() };
+            const fs::path destination{ path_u8 };
+            if (!GetShard(destination).m_Entries.contains(destination))
+            {
+                add_record(record, path_key);
+            }
+        }
     }
-    catch (const std::exception& e)
+
+    for (const OverlayShard& shard : m_Overlay)
     {
-        fmt::print("{}", e.what());
-        // Failed loading image database, continuing with an empty image databse...
-        return ImageDataBase{};
+        for (const auto& [destination, entry] : shard.m_Entries)
+        {
+            const std::u8string path_u8{ destination.u8string() };
+            add_record(ToRecord(entry), PathKey(path_u8));
+        }
+    }
+
+    // Keep the table at most half full, so probe sequences stay short
+    const uint32_t bucket_count{ std::bit_ceil(std::max(static_cast<uint32_t>(records.size()) * 2, 8u)) };
+    std::vector<uint32_t> buckets(bucket_count, 0);
+    for (uint32_t i = 0; i < records.size(); i++)
+    {
+        uint64_t bucket{ records[i].m_PathHash & (bucket_count - 1) };
+        while (buckets[bucket] != 0)
+        {
+            bucket = (bucket + 1) & (bucket_count - 1);
+        }
+        buckets[bucket] = i + 1;
+    }
+
+    SnapshotHeader header{};
+    std::ranges::copy(ImageDbFormatVersion(), header.m_Version.begin());
+    header.m_RecordSize = sizeof(SnapshotRecord);
+    header.m_RecordCount = static_cast<uint32_t>(records.size());
+    header.m_BucketCount = bucket_count;
+    header.m_PathPoolSize = path_pool.size();
+
+    // Write to a temporary file first so a crash never leaves us with neither snapshot nor journal
+    const fs::path temp_path{ fs::path{ path }.concat(".tmp") };
+    if (std::ofstream file{ temp_path, std::ios::binary | std::ios::trunc })
+    {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(SnapshotRecord));
+        file.write(path_pool.data(), path_pool.size());
+        file.close();
+        if (!file)
+        {
+            return;
+        }
+
+        const auto keep_in_memory{
+            [&]()
+            {
+                ClearOverlay();
+                for (const SnapshotRecord& record : records)
+                {
+                    const std::u8string_view path_u8{
+                        reinterpret_cast<const char8_t*>(path_pool.data() + record.m_PathOffset),
+                        record.m_PathSize,
+                    };
+                    const fs::path destination{ path_u8 };
+                    GetShard(destination).m_Entries[destination] = FromRecord(record);
+                }
+            }
+        };
+
+        // A mapped file can't be replaced on all platforms, everything we need is in the new snapshot now
+        const fs::path previous_snapshot{ m_Path };
+        m_Snapshot.reset();
+
+        std::error_code error_code;
+        fs::rename(temp_path, path, error_code);
+        if (error_code)
+        {
+            if (!MapSnapshot(previous_snapshot))
+            {
+                keep_in_memory();
+            }
+            return;
+        }
+
+        if (MapSnapshot(path))
+        {
+            ClearOverlay();
+        }
+        else
+        {
+            // Serve everything from memory instead, the snapshot on disk is still good
+            keep_in_memory();
+        }
+
+        m_Path = path;
+        OpenJournal(JournalPath(path));
     }
 }
 
-void ImageDataBase::Write(const fs::path& path)
+void ImageDataBase::CompactIfNeeded()
 {
-    if (std::ofstream file{ path })
+    FlushJournal();
+
     {
-        nlohmann::json json{};
-        json["version"] = ImageDbFormatVersion();
-        json["db"] = m_DataBase;
+        // Check without excluding everybody first, this is called a lot more often than it does anything
+        std::lock_guard journal_lock{ m_JournalMutex };
+        if (m_JournalEntries < c_JournalCompactionThreshold)
+        {
+            return;
+        }
+    }
 
-        file << json;
-        file.close();
+    std::unique_lock lock{ m_SnapshotMutex };
+    if (!m_Path.empty() && m_JournalEntries >= c_JournalCompactionThreshold)
+    {
+        WriteLocked(m_Path);
     }
 }
 
 bool ImageDataBase::FindEntry(const fs::path& destination) const
 {
-    return m_DataBase.contains(destination);
+    return GetEntry(destination).has_value();
 }
 
-QByteArray ImageDataBase::TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params) const
+std::optional<SourceVersion> ImageDataBase::TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params)
 {
-    if (!fs::exists(source))
+    std::optional<SourceFile> source_file{ SourceFile::Open(source) };
+    if (!source_file.has_value())
     {
-        return {};
+        return std::nullopt;
     }
+    return TestEntry(destination, source_file.value(), params);
+}
+
+std::optional<SourceVersion> ImageDataBase::TestEntry(const fs::path& destination, SourceFile& source, ImageParameters params)
+{
+    const std::optional<ImageDataBaseEntry> entry{ GetEntry(destination) };
 
-    auto get_source_data{
+    // Same size, modification time and inode means same contents, so we can trust the stored hash without reading anything
+    const bool stat_matches{ entry.has_value() && !entry->m_LegacyHash && entry->m_SourceStat == source.Stat() };
+    auto get_source_version{
         [&]()
         {
-            QFile source_file{ ToQString(source) };
-            source_file.open(QFile::ReadOnly);
-            return source_file.readAll();
+            return SourceVersion{
+                .m_Hash{ stat_matches ? entry->m_SourceHash : source.Hash() },
+                .m_Stat{ source.Stat() },
+            };
         }
     };
-    QByteArray cur_hash{ QCryptographicHash::hash(get_source_data(), QCryptographicHash::Md5) };
 
     if (params.m_WillWriteOutput && !fs::exists(destination))
     {
-        return cur_hash;
+        return get_source_version();
     }
 
-    auto it{ m_DataBase.find(destination) };
-    if (it != m_DataBase.end())
+    if (entry.has_value())
     {
-        if (it->second.m_Params != params)
+        if (entry->m_Params != params)
         {
-            return cur_hash;
+            return get_source_version();
         }
 
-        QByteArrayView hash{ it->second.m_SourceHash };
-        if (hash != cur_hash)
+        if (stat_matches)
         {
-            return cur_hash;
+            return std::nullopt;
         }
 
-        return {};
+        // The source was touched, but may still have the same contents
+        SourceVersion source_version{ get_source_version() };
+        if (entry->m_LegacyHash || source_version.m_Hash != entry->m_SourceHash)
+        {
+            return source_version;
+        }
+
+        // Remember the new stat, otherwise the output is never written again and we would hash the source on every check
+        PutEntry(destination, std::move(source_version), entry->m_Params);
+        return std::nullopt;
     }
-    return cur_hash;
+    return get_source_version();
 }
 
-void ImageDataBase::PutEntry(const fs::path& destination, QByteArray source_hash, ImageParameters params)
+void ImageDataBase::PutEntry(const fs::path& destination, SourceVersion source, ImageParameters params)
 {
-    m_DataBase[destination] = ImageDataBaseEntry{
-        .m_SourceHash{ std::move(source_hash) },
+    ImageDataBaseEntry entry{
+        .m_SourceHash{ std::move(source.m_Hash) },
+        .m_SourceStat{ source.m_Stat },
         .m_Params{ params },
     };
+
+    nlohmann::json json{};
+    json["destination"] = destination;
+    json["entry"] = entry;
+
+    std::shared_lock snapshot_lock{ m_SnapshotMutex };
+
+    {
+        // The sequence orders records for the same destination on replay, since they may be journaled out of order
+        OverlayShard& shard{ GetShard(destination) };
+        std::unique_lock shard_lock{ shard.m_Mutex };
+        shard.m_Entries[destination] = std::move(entry);
+        json["seq"] = m_PutSequence.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const std::string record{ json.dump() };
+    const bool should_flush{
+        [&]()
+        {
+            std::lock_guard journal_lock{ m_JournalMutex };
+            m_JournalBuffer += record;
+            m_JournalBuffer += '\n';
+            m_JournalBufferedRecords++;
+            m_JournalEntries++;
+            return m_JournalBuffer.size() >= c_JournalFlushSize ||
+                   m_JournalBufferedRecords >= c_JournalFlushRecords ||
+                   std::chrono::steady_clock::now() - m_JournalFlushPoint >= c_JournalFlushInterval;
+        }()
+    };
+
+    if (should_flush)
+    {
+        FlushJournalLocked();
+    }
+}
+
+void ImageDataBase::FlushJournal()
+{
+    std::shared_lock snapshot_lock{ m_SnapshotMutex };
+    FlushJournalLocked();
+}
+
+void ImageDataBase::FlushJournalLocked()
+{
+    // Only one thread writes at a time, so batches end up in the journal in the order they were taken
+    std::lock_guard write_lock{ m_JournalWriteMutex };
+
+    std::string records;
+    {
+        std::lock_guard journal_lock{ m_JournalMutex };
+        records.swap(m_JournalBuffer);
+        m_JournalBufferedRecords = 0;
+        m_JournalFlushPoint = std::chrono::steady_clock::now();
+    }
+
+    if (!records.empty() && m_Journal)
+    {
+        m_Journal << records << std::flush;
+    }
+}
+
+void ImageDataBase::ClearOverlay()
+{
+    for (OverlayShard& shard : m_Overlay)
+    {
+        shard.m_Entries.clear();
+    }
+}
+
+ImageDataBase::OverlayShard& ImageDataBase::GetShard(const fs::path& destination)
+{
+    return m_Overlay[std::hash<fs::path>{}(destination) % c_OverlayShards];
+}
+
+const ImageDataBase::OverlayShard& ImageDataBase::GetShard(const fs::path& destination) const
+{
+    return m_Overlay[std::hash<fs::path>{}(destination) % c_OverlayShards];
+}
+
+std::optional<ImageDataBaseEntry> ImageDataBase::GetEntry(const fs::path& destination) const
+{
+    std::shared_lock snapshot_lock{ m_SnapshotMutex };
+
+    {
+        const OverlayShard& shard{ GetShard(destination) };
+        std::shared_lock shard_lock{ shard.m_Mutex };
+        if (const auto it{ shard.m_Entries.find(destination) }; it != shard.m_Entries.end())
+        {
+            return it->second;
+        }
+    }
+
+    return FindSnapshotEntry(destination);
+}
+
+bool ImageDataBase::MapSnapshot(const fs::path& path)
+{
+    std::optional<MappedFile> snapshot{ MappedFile::Map(path) };
+    if (!snapshot.has_value())
+    {
+        return false;
+    }
+
+    const std::span<const std::byte> bytes{ snapshot->Bytes() };
+    if (bytes.size() < sizeof(SnapshotHeader))
+    {
+        return false;
+    }
+
+    const auto header{ ReadAt<SnapshotHeader>(bytes, 0) };
+    if (std::string_view{ header.m_Version.data(), header.m_Version.size() } != ImageDbFormatVersion() ||
+        header.m_RecordSize != sizeof(SnapshotRecord) ||
+        !std::has_single_bit(header.m_BucketCount) ||
+        PathPoolOffset(header) + header.m_PathPoolSize != bytes.size())
+    {
+        return false;
+    }
+
+    m_Snapshot = std::move(snapshot);
+    return true;
+}
+
+std::optional<ImageDataBaseEntry> ImageDataBase::FindSnapshotEntry(const fs::path& destination) const
+{
+    if (!m_Snapshot.has_value())
+    {
+        return std::nullopt;
+    }
+
+    const std::span<const std::byte> bytes{ m_Snapshot->Bytes() };
+    const auto header{ ReadAt<SnapshotHeader>(bytes, 0) };
+    const size_t records_offset{ RecordsOffset(header) };
+    const size_t path_pool_offset{ PathPoolOffset(header) };
+
+    const std::u8string path_u8{ destination.u8string() };
+    const std::string_view path_key{ PathKey(path_u8) };
+    const uint64_t path_hash{ HashPathKey(path_key) };
+
+    // Linear probing, the table is never more than half full so an empty bucket ends the search quickly
+    const uint32_t bucket_mask{ header.m_BucketCount - 1 };
+    uint64_t bucket{ path_hash & bucket_mask };
+    for (uint32_t probe = 0; probe < header.m_BucketCount; probe++, bucket = (bucket + 1) & bucket_mask)
+    {
+        const auto record_index{ ReadAt<uint32_t>(bytes, BucketsOffset() + bucket * sizeof(uint32_t)) };
+        if (record_index == 0 || record_index > header.m_RecordCount)
+        {
+            return std::nullopt;
+        }
+
+        const auto record{ ReadAt<SnapshotRecord>(bytes, records_offset + (record_index - 1) * sizeof(SnapshotRecord)) };
+        if (record.m_PathHash == path_hash &&
+            record.m_PathSize == path_key.size() &&
+            record.m_PathOffset + record.m_PathSize <= header.m_PathPoolSize &&
+            std::memcmp(bytes.data() + path_pool_offset + record.m_PathOffset, path_key.data(), path_key.size()) == 0)
+        {
+            return FromRecord(record);
+        }
+    }
+    return std::nullopt;
+}
+
+bool ImageDataBase::ReadJsonSnapshot(const fs::path& path)
+{
+    try
+    {
+        const nlohmann::json json{ nlohmann::json::parse(std::ifstream{ path }) };
+        if (!json.contains("version") || !json["version"].is_string() || !std::ranges::contains(c_JsonFormatVersions, json["version"].get_ref<const std::string&>()))
+        {
+            throw std::logic_error{ "Image databse version not compatible with App version..." };
+        }
+
+        for (auto& [destination, entry] : json["db"].get<std::unordered_map<fs::path, ImageDataBaseEntry>>())
+        {
+            GetShard(destination).m_Entries[destination] = std::move(entry);
+        }
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print("{}", e.what());
+        // Failed loading image database, continuing with an empty image databse...
+        ClearOverlay();
+        return false;
+    }
+}
+
+void ImageDataBase::OpenJournal(const fs::path& path)
+{
+    // Any previous journal content is either replayed or part of the snapshot at this point
+    m_Journal = std::ofstream{ path, std::ios::trunc };
+    m_JournalEntries = 0;
+    m_JournalBuffer.clear();
+    m_JournalBufferedRecords = 0;
+    if (m_Journal)
+    {
+        m_Journal << ImageDbFormatVersion() << '\n'
+                  << std::flush;
+    }
+}
+
+bool ImageDataBase::ReplayJournal(const fs::path& path)
+{
+    std::ifstream journal{ path };
+    if (!journal)
+    {
+        return false;
+    }
+
+    // Journal records didn't change with the binary snapshot format, so older journals can still be replayed
+    std::string line;
+    if (!std::getline(journal, line) || (line != ImageDbFormatVersion() && !std::ranges::contains(c_JsonFormatVersions, line)))
+    {
+        return false;
+    }
+
+    // Records are batched, so a later record for a destination may have been put earlier, the highest sequence wins
+    std::unordered_map<fs::path, uint64_t> sequences;
+
+    bool replayed_any{ false };
+    while (std::getline(journal, line))
+    {
+        replayed_any = true;
+        try
+        {
+            const nlohmann::json json{ nlohmann::json::parse(line) };
+            const fs::path destination{ json["destination"].get<fs::path>() };
+            const uint64_t sequence{ json.contains("seq") ? json["seq"].get<uint64_t>() : 0 };
+            if (const auto it{ sequences.find(destination) }; it != sequences.end() && it->second > sequence)
+            {
+                continue;
+            }
+
+            sequences[destination] = sequence;
+            GetShard(destination).m_Entries[destination] = json["entry"].get<ImageDataBaseEntry>();
+        }
+        catch (const std::exception&)
+        {
+            // Only the last record can be torn by a crash, nothing valid follows it
+            break;
+        }
+    }
+
+    return replayed_any;
 }
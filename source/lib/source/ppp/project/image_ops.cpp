@@ -1,7 +1,11 @@
 #include <ppp/project/image_ops.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cctype>
 #include <charconv>
+#include <cstdlib>
+#include <optional>
 #include <ranges>
 #include <string>
 
@@ -11,6 +15,7 @@
 
 #include <opencv2/opencv.hpp>
 
+#include <QCryptographicHash>
 #include <QFile>
 #include <QString>
 
@@ -41,12 +46,12 @@ std::vector<fs::path> ListImageFiles(const fs::path& path_one, const fs::path& p
     return images;
 }
 
-Image CropImage(const Image& image,
-                const fs::path& image_name,
-                Size card_size,
-                Length full_bleed,
-                Length bleed_edge,
-                PixelDensity max_density)
+ImageTransform CropTransform(const Image& image,
+                             const fs::path& image_name,
+                             Size card_size,
+                             Length full_bleed,
+                             Length bleed_edge,
+                             PixelDensity max_density)
 {
     const Size card_size_with_full_bleed{ card_size + 2 * full_bleed };
     const PixelDensity density{ image.Density(card_size_with_full_bleed) };
@@ -55,7 +60,7 @@ Image CropImage(const Image& image,
     if (density <= 0_dpi)
     {
         LogInfo("Cropping images...\n{} - DPI calculated: 0, skipping cropping for image", image_name.string());
-        return image;
+        return ImageTransform{};
     }
     
     Pixel c{ full_bleed * density };
@@ -78,15 +83,347 @@ Image CropImage(const Image& image,
         }
     }
 
-    Image cropped_image{ image.Crop(c, c, c, c) };
+    ImageTransform transform{
+        .m_CropLeft{ c },
+        .m_CropTop{ c },
+        .m_CropRight{ c },
+        .m_CropBottom{ c },
+    };
     if (density > max_density)
     {
-        const PixelSize new_size{ dla::round(cropped_image.Size() * (max_density / density)) };
+        const PixelSize cropped_size{ image.Size() - PixelSize{ 2 * c, 2 * c } };
+        const PixelSize new_size{ dla::round(cropped_size * (max_density / density)) };
         const PixelDensity max_dpi{ (max_density * 1_in / 1_m) };
         LogInfo("Cropping images...\n{} - Exceeds maximum DPI {}, resizing to {}", image_name.string(), max_dpi.value, static_cast<dla::uvec2>(new_size / 1_pix));
-        return cropped_image.Resize(new_size);
+        transform.m_Size = new_size;
+    }
+    return transform;
+}
+
+Image CropImage(const Image& image,
+                const fs::path& image_name,
+                Size card_size,
+                Length full_bleed,
+                Length bleed_edge,
+                PixelDensity max_density)
+{
+    return TransformImage(image, CropTransform(image, image_name, card_size, full_bleed, bleed_edge, max_density));
+}
+
+namespace
+{
+// Output is produced in square tiles, small enough that a tile and its intermediates stay in cache
+inline constexpr int c_TransformTileSize{ 128 };
+
+// Source pixels contributing to each target pixel along one axis, computed once for the whole
+// image so that tiles line up seamlessly, taps of consecutive target pixels never move backwards
+struct ResampleAxis
+{
+    // Index of the first tap per target pixel, with one extra entry marking the end
+    std::vector<int32_t> m_First;
+    std::vector<int32_t> m_Source;
+    std::vector<float> m_Weight;
+};
+
+ResampleAxis BuildResampleAxis(int source_size, int target_size)
+{
+    ResampleAxis axis{};
+    axis.m_First.reserve(target_size + 1);
+
+    const double scale{ static_cast<double>(source_size) / target_size };
+    for (int i = 0; i < target_size; i++)
+    {
+        axis.m_First.push_back(static_cast<int32_t>(axis.m_Source.size()));
+        if (scale >= 1.0)
+        {
+            // Shrinking, average all source pixels covered by this pixel, weighted by coverage
+            const double begin{ i * scale };
+            const double end{ std::min((i + 1) * scale, static_cast<double>(source_size)) };
+            for (int j = static_cast<int>(begin); j < end; j++)
+            {
+                const double coverage{ std::min(end, j + 1.0) - std::max(begin, static_cast<double>(j)) };
+                if (coverage > 1e-6)
+                {
+                    axis.m_Source.push_back(j);
+                    axis.m_Weight.push_back(static_cast<float>(coverage / scale));
+                }
+            }
+        }
+        else
+        {
+            // Growing, interpolate between the two nearest source pixels
+            const double center{ (i + 0.5) * scale - 0.5 };
+            const int lo{ static_cast<int>(std::floor(center)) };
+            const float frac{ static_cast<float>(center - lo) };
+            axis.m_Source.push_back(std::clamp(lo, 0, source_size - 1));
+            axis.m_Weight.push_back(1.0f - frac);
+            axis.m_Source.push_back(std::clamp(lo + 1, 0, source_size - 1));
+            axis.m_Weight.push_back(frac);
+        }
     }
-    return cropped_image;
+    axis.m_First.push_back(static_cast<int32_t>(axis.m_Source.size()));
+
+    return axis;
+}
+
+// Resamples the source into one tile of the target, first horizontally into a float buffer
+// holding only the source rows this tile needs, then vertically into the target
+void ResampleTile(const cv::Mat& source,
+                  const ResampleAxis& x_axis,
+                  const ResampleAxis& y_axis,
+                  const cv::Rect& tile,
+                  cv::Mat& horizontal,
+                  cv::Mat& accumulator,
+                  cv::Mat& target)
+{
+    const int channels{ source.channels() };
+    const int target_channels{ target.channels() };
+    const int row_length{ tile.width * channels };
+
+    const int source_begin{ y_axis.m_Source[y_axis.m_First[tile.y]] };
+    const int source_end{ y_axis.m_Source[y_axis.m_First[tile.y + tile.height] - 1] + 1 };
+
+    horizontal.create(source_end - source_begin, row_length, CV_32FC1);
+    for (int y = source_begin; y < source_end; y++)
+    {
+        const uchar* src{ source.ptr<uchar>(y) };
+        float* dst{ horizontal.ptr<float>(y - source_begin) };
+        for (int x = 0; x < tile.width; x++)
+        {
+            std::array<float, 4> sums{};
+            for (int32_t t = x_axis.m_First[tile.x + x]; t < x_axis.m_First[tile.x + x + 1]; t++)
+            {
+                const float weight{ x_axis.m_Weight[t] };
+                const uchar* pixel{ src + x_axis.m_Source[t] * channels };
+                for (int c = 0; c < channels; c++)
+                {
+                    sums[c] += weight * pixel[c];
+                }
+            }
+            std::copy_n(sums.begin(), channels, dst + x * channels);
+        }
+    }
+
+    accumulator.create(1, row_length, CV_32FC1);
+    float* sums{ accumulator.ptr<float>() };
+    for (int y = 0; y < tile.height; y++)
+    {
+        std::fill_n(sums, row_length, 0.0f);
+        for (int32_t t = y_axis.m_First[tile.y + y]; t < y_axis.m_First[tile.y + y + 1]; t++)
+        {
+            const float weight{ y_axis.m_Weight[t] };
+            const float* row{ horizontal.ptr<float>(y_axis.m_Source[t] - source_begin) };
+            for (int i = 0; i < row_length; i++)
+            {
+                sums[i] += weight * row[i];
+            }
+        }
+
+        uchar* dst{ target.ptr<uchar>(y) };
+        for (int x = 0; x < tile.width; x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                dst[x * target_channels + c] = cv::saturate_cast<uchar>(sums[x * channels + c]);
+            }
+            if (target_channels > channels)
+            {
+                dst[x * target_channels + channels] = 255;
+            }
+        }
+    }
+}
+
+// Same radius and early outs as Image::RoundCorners, returns zero if corners stay as they are
+int CornerRadiusPixels(cv::Size size, const ImageTransform& transform)
+{
+    if (transform.m_CornerRadius <= 0_mm || transform.m_CornerRadius == 1_mm)
+    {
+        return 0;
+    }
+
+    const auto [bw, bh]{ transform.m_CardSize.pod() };
+    if (bw <= 0_m || bh <= 0_m)
+    {
+        return 0;
+    }
+
+    const PixelDensity density{ dla::math::min(size.width * 1_pix / bw, size.height * 1_pix / bh) };
+    return static_cast<int>(dla::math::floor(density * transform.m_CornerRadius) / 1_pix);
+}
+
+// Multiplies the alpha of all pixels of the tile that fall into one of the corners with the stencil
+void RoundTileCorners(const cv::Mat& stencil, cv::Size size, const cv::Rect& tile, cv::Mat& target)
+{
+    const int radius{ stencil.rows };
+    for (int y = 0; y < tile.height; y++)
+    {
+        const int image_y{ tile.y + y };
+        const int stencil_y{ std::min(image_y, size.height - 1 - image_y) };
+        if (stencil_y >= radius)
+        {
+            continue;
+        }
+
+        const uchar* stencil_row{ stencil.ptr<uchar>(stencil_y) };
+        uchar* row{ target.ptr<uchar>(y) };
+        const auto round_columns{
+            [&](int begin, int end)
+            {
+                for (int image_x = std::max(begin, tile.x); image_x < std::min(end, tile.x + tile.width); image_x++)
+                {
+                    const int stencil_x{ std::min(image_x, size.width - 1 - image_x) };
+                    uchar& alpha{ row[(image_x - tile.x) * 4 + 3] };
+                    alpha = static_cast<uchar>((alpha * stencil_row[stencil_x] + 127) / 255);
+                }
+            }
+        };
+        round_columns(0, std::min(radius, size.width));
+        round_columns(std::max(size.width - radius, radius), size.width);
+    }
+}
+
+// Where a tile ends up in the target after rotating it
+cv::Rect RotateTile(const cv::Rect& tile, cv::Size size, Image::Rotation rotation)
+{
+    switch (rotation)
+    {
+    case Image::Rotation::Degree90:
+        return cv::Rect{ size.height - tile.y - tile.height, tile.x, tile.height, tile.width };
+    case Image::Rotation::Degree180:
+        return cv::Rect{ size.width - tile.x - tile.width, size.height - tile.y - tile.height, tile.width, tile.height };
+    case Image::Rotation::Degree270:
+        return cv::Rect{ tile.y, size.width - tile.x - tile.width, tile.height, tile.width };
+    default:
+        return tile;
+    }
+}
+
+cv::Mat To8Bit(const cv::Mat& image)
+{
+    switch (image.depth())
+    {
+    case CV_8U:
+        return image;
+    case CV_16U:
+    {
+        cv::Mat converted;
+        image.convertTo(converted, CV_8U, 255.0 / 65535.0);
+        return converted;
+    }
+    default:
+    {
+        // Anything else is rare enough to just stretch its range into 8 bit
+        cv::Mat converted;
+        cv::normalize(image, converted, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
+        return converted;
+    }
+    }
+}
+
+std::optional<cv::RotateFlags> RotateCode(Image::Rotation rotation)
+{
+    switch (rotation)
+    {
+    case Image::Rotation::Degree90:
+        return cv::ROTATE_90_CLOCKWISE;
+    case Image::Rotation::Degree180:
+        return cv::ROTATE_180;
+    case Image::Rotation::Degree270:
+        return cv::ROTATE_90_COUNTERCLOCKWISE;
+    default:
+        return std::nullopt;
+    }
+}
+} // namespace
+
+Image TransformImage(const Image& image, const ImageTransform& transform)
+{
+    const Image cropped{ image.Crop(transform.m_CropLeft, transform.m_CropTop, transform.m_CropRight, transform.m_CropBottom) };
+    const cv::Mat& cropped_source{ cropped.GetUnderlying() };
+    const cv::Size source_size{ cropped_source.cols, cropped_source.rows };
+    const cv::Size size{
+        transform.m_Size.x > 0_pix && transform.m_Size.y > 0_pix
+            ? cv::Size{ static_cast<int>(transform.m_Size.x / 1_pix), static_cast<int>(transform.m_Size.y / 1_pix) }
+            : source_size
+    };
+
+    const bool has_color_channels{ cropped_source.channels() == 3 || cropped_source.channels() == 4 };
+    const bool resize{ size != source_size };
+    const bool apply_color_cube{ has_color_channels && transform.m_ColorCube != nullptr && transform.m_ColorCube->Valid() };
+    const int corner_radius{ has_color_channels ? CornerRadiusPixels(size, transform) : 0 };
+    if (!resize && !apply_color_cube && corner_radius == 0)
+    {
+        return cropped.Rotate(transform.m_Rotation);
+    }
+
+    // The tiles are resampled, color corrected and rounded in 8 bit, so deeper sources are scaled down first
+    const cv::Mat source{ To8Bit(cropped_source) };
+
+    const std::optional rotate_code{ RotateCode(transform.m_Rotation) };
+    const bool swap_axes{ transform.m_Rotation == Image::Rotation::Degree90 || transform.m_Rotation == Image::Rotation::Degree270 };
+    const int channels{ corner_radius > 0 ? 4 : source.channels() };
+    cv::Mat output{
+        swap_axes ? size.width : size.height,
+        swap_axes ? size.height : size.width,
+        CV_8UC(channels),
+    };
+
+    const ResampleAxis x_axis{ BuildResampleAxis(source_size.width, size.width) };
+    const ResampleAxis y_axis{ BuildResampleAxis(source_size.height, size.height) };
+    const cv::Mat stencil{ corner_radius > 0 ? Image::CornerStencil(corner_radius) : cv::Mat{} };
+
+    const int tiles_x{ (size.width + c_TransformTileSize - 1) / c_TransformTileSize };
+    const int tiles_y{ (size.height + c_TransformTileSize - 1) / c_TransformTileSize };
+    cv::parallel_for_(
+        cv::Range{ 0, tiles_x * tiles_y },
+        [&](const cv::Range& tiles)
+        {
+            cv::Mat horizontal;
+            cv::Mat accumulator;
+            cv::Mat tile_buffer;
+            for (int i = tiles.start; i < tiles.end; i++)
+            {
+                const cv::Rect tile{
+                    cv::Rect{
+                        (i % tiles_x) * c_TransformTileSize,
+                        (i / tiles_x) * c_TransformTileSize,
+                        c_TransformTileSize,
+                        c_TransformTileSize,
+                    } &
+                    cv::Rect{ cv::Point{}, size },
+                };
+
+                // Without rotation we work straight in the output, otherwise in a buffer we rotate into place
+                cv::Mat target;
+                if (rotate_code.has_value())
+                {
+                    tile_buffer.create(tile.size(), output.type());
+                    target = tile_buffer;
+                }
+                else
+                {
+                    target = output(tile);
+                }
+
+                ResampleTile(source, x_axis, y_axis, tile, horizontal, accumulator, target);
+                if (apply_color_cube)
+                {
+                    transform.m_ColorCube->Apply(target, target);
+                }
+                if (corner_radius > 0)
+                {
+                    RoundTileCorners(stencil, size, tile, target);
+                }
+                if (rotate_code.has_value())
+                {
+                    cv::Mat rotated_target{ output(RotateTile(tile, size, transform.m_Rotation)) };
+                    cv::rotate(target, rotated_target, rotate_code.value());
+                }
+            }
+        });
+
+    return Image{ output };
 }
 
 Image UncropImage(const Image& image, const fs::path& image_name, Size card_size, bool fancy_uncrop)
@@ -236,80 +573,248 @@ void WritePreviews(const fs::path& img_cache_file, const ImgDict& img_dict)
     }
 }
 
-cv::Mat LoadColorCube(const fs::path& file_path)
+namespace
 {
-    QFile color_cube_file{ ToQString(file_path) };
-    color_cube_file.open(QFile::ReadOnly);
-    const std::string color_cube_raw{ QLatin1String{ color_cube_file.readAll() }.toString().toStdString() };
-
-    static constexpr auto c_ToStringViews{ std::views::transform(
-        [](auto str)
-        { return std::string_view(str.data(), str.size()); }) };
-    static constexpr auto c_ToInt{ std::views::transform(
-        [](std::string_view str)
-        {
-            int val;
-            std::from_chars(str.data(), str.data() + str.size(), val);
-            return val;
-        }) };
-    static constexpr auto c_ToFloat{ std::views::transform(
-        [](std::string_view str)
-        {
-            float val;
+std::string_view TrimWhitespace(std::string_view str)
+{
+    static constexpr std::string_view c_Whitespace{ " \t\r" };
+    const size_t first{ str.find_first_not_of(c_Whitespace) };
+    if (first == std::string_view::npos)
+    {
+        return {};
+    }
+    const size_t last{ str.find_last_not_of(c_Whitespace) };
+    return str.substr(first, last - first + 1);
+}
+
+// Consumes one number from the front of the string, returns false if there is none
+template<class T>
+bool ConsumeNumber(std::string_view& str, T& value)
+{
+    str = TrimWhitespace(str);
+    const char* begin{ str.data() };
+    const char* end{ str.data() + str.size() };
+
 #ifdef __clang__
-            // Clang and AppleClang do not support std::from_chars overloads with floating points
-            val = std::stof(std::string{ str });
-#else
-            std::from_chars(str.data(), str.data() + str.size(), val);
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        // Clang and AppleClang do not support std::from_chars overloads with floating points,
+        // copy into a small buffer so strtof sees a terminated string without allocating
+        std::array<char, 64> buffer{};
+        const size_t length{ std::min(str.size(), buffer.size() - 1) };
+        std::copy_n(begin, length, buffer.data());
+        char* parse_end{ nullptr };
+        value = std::strtof(buffer.data(), &parse_end);
+        if (parse_end == buffer.data())
+        {
+            return false;
+        }
+        str.remove_prefix(parse_end - buffer.data());
+        return true;
+    }
+    else
 #endif
-            return val;
-        }) };
-    static constexpr auto c_FloatColorToInt{ std::views::transform(
-        [](float val)
-        { return static_cast<uint8_t>(val * 255); }) };
-    static constexpr auto c_ToColor{ std::views::transform(
-        [](std::string_view str)
+    {
+        const auto [ptr, ec]{ std::from_chars(begin, end, value) };
+        if (ec != std::errc{})
         {
-            return std::views::split(str, ' ') |
-                   c_ToStringViews |
-                   c_ToFloat |
-                   c_FloatColorToInt |
-                   std::ranges::to<std::vector>();
-        }) };
-    const int color_cube_size{
-        ((color_cube_raw |
-          std::views::split('\n') |
-          std::views::drop(4) |
-          std::views::take(1) |
-          c_ToStringViews |
-          std::ranges::to<std::vector>())
-             .front() |
-         std::views::split(' ') |
-         std::views::drop(1) |
-         c_ToStringViews |
-         c_ToInt |
-         std::ranges::to<std::vector>())
-            .front()
-    };
-    const std::vector color_cube_data{
-        color_cube_raw |
-        std::views::split('\n') |
-        std::views::drop(11) |
-        c_ToStringViews |
-        c_ToColor |
-        std::views::join |
-        std::ranges::to<std::vector>()
-    };
+            return false;
+        }
+        str.remove_prefix(ptr - begin);
+        return true;
+    }
+}
 
-    const int size{ color_cube_size };
-    const int data_size{ size * size * size * 3 };
+bool ConsumeTriplet(std::string_view& str, std::array<float, 3>& values)
+{
+    return ConsumeNumber(str, values[0]) &&
+           ConsumeNumber(str, values[1]) &&
+           ConsumeNumber(str, values[2]);
+}
+} // namespace
+
+ColorCubeLattice ParseColorCube(std::string_view color_cube_raw)
+{
+    ColorCubeLattice color_cube{};
+
+    int size{ 0 };
+    std::vector<uint8_t> color_cube_data;
+
+    // Walk the file once, line by line, without copying any of it
+    while (!color_cube_raw.empty())
+    {
+        const size_t line_end{ color_cube_raw.find('\n') };
+        std::string_view line{ TrimWhitespace(color_cube_raw.substr(0, line_end)) };
+        color_cube_raw.remove_prefix(line_end == std::string_view::npos ? color_cube_raw.size() : line_end + 1);
+
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        const bool is_data{ std::isdigit(static_cast<unsigned char>(line.front())) || line.front() == '-' || line.front() == '.' };
+        if (is_data)
+        {
+            if (size == 0)
+            {
+                LogError("Color cube data before LUT_3D_SIZE...");
+                return {};
+            }
 
-    cv::Mat color_cube;
-    color_cube.create(std::vector<int>{ size, size, size }, CV_8UC3);
-    color_cube.cols = size;
-    color_cube.rows = size;
-    assert(color_cube.dataend - color_cube.datastart == data_size);
-    memcpy(color_cube.data, color_cube_data.data(), data_size);
+            std::array<float, 3> color;
+            if (!ConsumeTriplet(line, color))
+            {
+                LogError("Malformed color cube data line: {}", line);
+                return {};
+            }
+
+            for (float channel : color)
+            {
+                color_cube_data.push_back(static_cast<uint8_t>(std::clamp(channel, 0.0f, 1.0f) * 255));
+            }
+            continue;
+        }
+
+        const size_t keyword_end{ line.find_first_of(" \t") };
+        const std::string_view keyword{ line.substr(0, keyword_end) };
+        std::string_view arguments{ keyword_end == std::string_view::npos ? std::string_view{} : line.substr(keyword_end) };
+        if (keyword == "LUT_3D_SIZE")
+        {
+            if (!ConsumeNumber(arguments, size) || size < 2 || size > 256)
+            {
+                LogError("Invalid LUT_3D_SIZE in color cube: {}", line);
+                return {};
+            }
+            color_cube_data.reserve(static_cast<size_t>(size) * size * size * 3);
+        }
+        else if (keyword == "DOMAIN_MIN")
+        {
+            if (!ConsumeTriplet(arguments, color_cube.m_DomainMin))
+            {
+                LogError("Invalid DOMAIN_MIN in color cube: {}", line);
+                return {};
+            }
+        }
+        else if (keyword == "DOMAIN_MAX")
+        {
+            if (!ConsumeTriplet(arguments, color_cube.m_DomainMax))
+            {
+                LogError("Invalid DOMAIN_MAX in color cube: {}", line);
+                return {};
+            }
+        }
+        else if (keyword == "LUT_3D_INPUT_RANGE")
+        {
+            // Older form of the domain keywords, the same range for all channels
+            float range_min;
+            float range_max;
+            if (!ConsumeNumber(arguments, range_min) || !ConsumeNumber(arguments, range_max))
+            {
+                LogError("Invalid LUT_3D_INPUT_RANGE in color cube: {}", line);
+                return {};
+            }
+            color_cube.m_DomainMin = { range_min, range_min, range_min };
+            color_cube.m_DomainMax = { range_max, range_max, range_max };
+        }
+        else if (keyword == "LUT_1D_SIZE")
+        {
+            LogError("1D color lookup tables are not supported...");
+            return {};
+        }
+
+        // Anything else, e.g. TITLE, carries no information we need
+    }
+
+    const size_t expected_size{ static_cast<size_t>(size) * size * size * 3 };
+    if (size == 0 || color_cube_data.size() != expected_size)
+    {
+        LogError("Color cube has {} values, expected {}...", color_cube_data.size(), expected_size);
+        return {};
+    }
+
+    for (size_t c = 0; c < 3; c++)
+    {
+        if (color_cube.m_DomainMax[c] <= color_cube.m_DomainMin[c])
+        {
+            LogError("Color cube has an empty domain...");
+            return {};
+        }
+    }
+
+    cv::Mat& lattice{ color_cube.m_Lattice };
+    lattice.create(std::vector<int>{ size, size, size }, CV_8UC3);
+    lattice.cols = size;
+    lattice.rows = size;
+    memcpy(lattice.data, color_cube_data.data(), expected_size);
+
+    return color_cube;
+}
+
+ColorCubeLattice LoadColorCube(const fs::path& file_path)
+{
+    QFile color_cube_file{ ToQString(file_path) };
+    if (!color_cube_file.open(QFile::ReadOnly))
+    {
+        LogError("Failed opening color cube {}...", file_path.string());
+        return {};
+    }
+
+    // Parse straight out of the mapped file where possible, some resources can't be mapped
+    if (const uchar* mapped{ color_cube_file.map(0, color_cube_file.size()) })
+    {
+        return ParseColorCube(std::string_view{ reinterpret_cast<const char*>(mapped), static_cast<size_t>(color_cube_file.size()) });
+    }
+
+    const QByteArray color_cube_raw{ color_cube_file.readAll() };
+    return ParseColorCube(std::string_view{ color_cube_raw.constData(), static_cast<size_t>(color_cube_raw.size()) });
+}
+
+ColorCube LoadCompiledColorCube(const fs::path& file_path, const fs::path& cache_dir)
+{
+    QFile color_cube_file{ ToQString(file_path) };
+    if (!color_cube_file.open(QFile::ReadOnly))
+    {
+        LogError("Failed opening color cube {}...", file_path.string());
+        return {};
+    }
+
+    const QByteArray hash{ QCryptographicHash::hash(color_cube_file.readAll(), QCryptographicHash::Md5) };
+    const fs::path compiled_path{ cache_dir / fmt::format("{}.ppcube", hash.toHex().toStdString()) };
+
+    {
+        QFile compiled_file{ ToQString(compiled_path) };
+        if (compiled_file.open(QFile::ReadOnly))
+        {
+            if (const uchar* mapped{ compiled_file.map(0, compiled_file.size()) })
+            {
+                ColorCube color_cube{ ColorCube::Deserialize(std::span{ reinterpret_cast<const std::byte*>(mapped), static_cast<size_t>(compiled_file.size()) }) };
+                if (color_cube)
+                {
+                    return color_cube;
+                }
+            }
+        }
+    }
+
+    LogInfo("Compiling color cube {}...", file_path.string());
+    ColorCube color_cube{ LoadColorCube(file_path) };
+    if (!color_cube)
+    {
+        return color_cube;
+    }
+
+    // Failing to write the cache only costs us the compilation next time
+    std::error_code error_code;
+    fs::create_directories(cache_dir, error_code);
+    if (!error_code)
+    {
+        QFile compiled_file{ ToQString(compiled_path) };
+        if (compiled_file.open(QFile::WriteOnly))
+        {
+            const std::vector<std::byte> compiled{ color_cube.Serialize() };
+            compiled_file.write(reinterpret_cast<const char*>(compiled.data()), static_cast<qint64>(compiled.size()));
+        }
+    }
 
     return color_cube;
 }
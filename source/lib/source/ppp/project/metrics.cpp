@@ -0,0 +1,155 @@
+#include <ppp/project/metrics.hpp>
+
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+MetricsRegistry::MetricsRegistry()
+    : m_ResetPoint{ std::chrono::steady_clock::now() }
+{
+}
+
+void MetricsRegistry::RecordTiming(std::string_view name, std::chrono::nanoseconds duration)
+{
+    std::lock_guard lock{ m_Mutex };
+    auto it{ m_Timings.find(name) };
+    if (it == m_Timings.end())
+    {
+        it = m_Timings.emplace(std::string{ name }, TimingStats{}).first;
+    }
+
+    TimingStats& stats{ it->second };
+    stats.m_Count++;
+    stats.m_Total += duration;
+    stats.m_Min = std::min(stats.m_Min, duration);
+    stats.m_Max = std::max(stats.m_Max, duration);
+}
+
+void MetricsRegistry::AddCount(std::string_view name, uint64_t count)
+{
+    std::lock_guard lock{ m_Mutex };
+    auto it{ m_Counters.find(name) };
+    if (it == m_Counters.end())
+    {
+        it = m_Counters.emplace(std::string{ name }, 0).first;
+    }
+    it->second += count;
+}
+
+void MetricsRegistry::SetGauge(std::string_view name, double value)
+{
+    std::lock_guard lock{ m_Mutex };
+    auto it{ m_Gauges.find(name) };
+    if (it == m_Gauges.end())
+    {
+        m_Gauges.emplace(std::string{ name }, value);
+    }
+    else
+    {
+        it->second = value;
+    }
+}
+
+std::optional<MetricsRegistry::TimingStats> MetricsRegistry::GetTiming(std::string_view name) const
+{
+    std::lock_guard lock{ m_Mutex };
+    const auto it{ m_Timings.find(name) };
+    if (it == m_Timings.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+uint64_t MetricsRegistry::GetCount(std::string_view name) const
+{
+    std::lock_guard lock{ m_Mutex };
+    const auto it{ m_Counters.find(name) };
+    return it != m_Counters.end() ? it->second : 0;
+}
+
+std::optional<double> MetricsRegistry::GetGauge(std::string_view name) const
+{
+    std::lock_guard lock{ m_Mutex };
+    const auto it{ m_Gauges.find(name) };
+    if (it == m_Gauges.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+double MetricsRegistry::GetThroughput(std::string_view name) const
+{
+    const uint64_t count{ GetCount(name) };
+
+    std::lock_guard lock{ m_Mutex };
+    const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - m_ResetPoint };
+    return elapsed.count() > 0.0 ? static_cast<double>(count) / elapsed.count() : 0.0;
+}
+
+std::string MetricsRegistry::DumpJson() const
+{
+    std::lock_guard lock{ m_Mutex };
+
+    const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - m_ResetPoint };
+    const auto to_ms{
+        [](std::chrono::nanoseconds duration)
+        {
+            return std::chrono::duration<double, std::milli>{ duration }.count();
+        }
+    };
+
+    nlohmann::json json{};
+    json["elapsed_seconds"] = elapsed.count();
+
+    nlohmann::json& timings{ json["timings"] = nlohmann::json::object() };
+    for (const auto& [name, stats] : m_Timings)
+    {
+        timings[name] = nlohmann::json{
+            { "count", stats.m_Count },
+            { "total_ms", to_ms(stats.m_Total) },
+            { "mean_ms", to_ms(stats.m_Total) / static_cast<double>(stats.m_Count) },
+            { "min_ms", to_ms(stats.m_Min) },
+            { "max_ms", to_ms(stats.m_Max) },
+        };
+    }
+
+    nlohmann::json& counters{ json["counters"] = nlohmann::json::object() };
+    for (const auto& [name, count] : m_Counters)
+    {
+        counters[name] = nlohmann::json{
+            { "count", count },
+            { "per_second", elapsed.count() > 0.0 ? static_cast<double>(count) / elapsed.count() : 0.0 },
+        };
+    }
+
+    nlohmann::json& gauges{ json["gauges"] = nlohmann::json::object() };
+    for (const auto& [name, value] : m_Gauges)
+    {
+        gauges[name] = value;
+    }
+
+    return json.dump(4);
+}
+
+void MetricsRegistry::Reset()
+{
+    std::lock_guard lock{ m_Mutex };
+    m_ResetPoint = std::chrono::steady_clock::now();
+    m_Timings.clear();
+    m_Counters.clear();
+    m_Gauges.clear();
+}
+
+MetricsRegistry::ScopedTimer::ScopedTimer(MetricsRegistry& registry, std::string_view name)
+    : m_Registry{ registry }
+    , m_Name{ name }
+    , m_StartPoint{ std::chrono::steady_clock::now() }
+{
+}
+
+MetricsRegistry::ScopedTimer::~ScopedTimer()
+{
+    m_Registry.RecordTiming(m_Name, std::chrono::steady_clock::now() - m_StartPoint);
+}
@@ -0,0 +1,138 @@
+#include <ppp/project/work_queue.hpp>
+
+#include <ranges>
+
+bool WorkQueue::Push(const fs::path& path)
+{
+    if (m_Index.contains(path))
+    {
+        return false;
+    }
+
+    if (const auto it{ m_DelayedIndex.find(path) }; it != m_DelayedIndex.end())
+    {
+        m_Delayed.erase(it->second);
+        m_DelayedIndex.erase(it);
+    }
+
+    m_Queue.push_back(path);
+    m_Index.emplace(path, std::prev(m_Queue.end()));
+    return true;
+}
+
+bool WorkQueue::PushFront(const fs::path& path)
+{
+    if (m_Index.contains(path))
+    {
+        return false;
+    }
+
+    if (const auto it{ m_DelayedIndex.find(path) }; it != m_DelayedIndex.end())
+    {
+        m_Delayed.erase(it->second);
+        m_DelayedIndex.erase(it);
+    }
+
+    m_Queue.push_front(path);
+    m_Index.emplace(path, m_Queue.begin());
+    return true;
+}
+
+bool WorkQueue::PushDelayed(const fs::path& path, Clock::time_point not_before)
+{
+    if (m_Index.contains(path) || m_DelayedIndex.contains(path))
+    {
+        return false;
+    }
+
+    m_DelayedIndex.emplace(path, m_Delayed.emplace(not_before, path));
+    return true;
+}
+
+bool WorkQueue::Remove(const fs::path& path)
+{
+    if (const auto it{ m_DelayedIndex.find(path) }; it != m_DelayedIndex.end())
+    {
+        m_Delayed.erase(it->second);
+        m_DelayedIndex.erase(it);
+        return true;
+    }
+
+    const auto it{ m_Index.find(path) };
+    if (it == m_Index.end())
+    {
+        return false;
+    }
+
+    m_Queue.erase(it->second);
+    m_Index.erase(it);
+    return true;
+}
+
+std::optional<fs::path> WorkQueue::Pop(Clock::time_point now)
+{
+    while (!m_Delayed.empty() && m_Delayed.begin()->first <= now)
+    {
+        fs::path path{ std::move(m_Delayed.begin()->second) };
+        m_DelayedIndex.erase(path);
+        m_Delayed.erase(m_Delayed.begin());
+
+        m_Queue.push_back(path);
+        m_Index.emplace(std::move(path), std::prev(m_Queue.end()));
+    }
+
+    if (m_Queue.empty())
+    {
+        return std::nullopt;
+    }
+
+    fs::path path{ std::move(m_Queue.front()) };
+    m_Queue.pop_front();
+    m_Index.erase(path);
+    return path;
+}
+
+void WorkQueue::MoveToFront(std::span<const fs::path> paths)
+{
+    // Splice in reverse so the first path ends up in front
+    for (const fs::path& path : paths | std::views::reverse)
+    {
+        const auto it{ m_Index.find(path) };
+        if (it != m_Index.end())
+        {
+            m_Queue.splice(m_Queue.begin(), m_Queue, it->second);
+        }
+    }
+}
+
+std::optional<WorkQueue::Clock::time_point> WorkQueue::NextDelayed() const
+{
+    if (m_Delayed.empty())
+    {
+        return std::nullopt;
+    }
+    return m_Delayed.begin()->first;
+}
+
+bool WorkQueue::Contains(const fs::path& path) const
+{
+    return m_Index.contains(path) || m_DelayedIndex.contains(path);
+}
+
+size_t WorkQueue::Size() const
+{
+    return m_Queue.size();
+}
+
+bool WorkQueue::Empty() const
+{
+    return m_Queue.empty();
+}
+
+void WorkQueue::Clear()
+{
+    m_Queue.clear();
+    m_Index.clear();
+    m_Delayed.clear();
+    m_DelayedIndex.clear();
+}
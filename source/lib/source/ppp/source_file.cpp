@@ -0,0 +1,73 @@
+#include <ppp/source_file.hpp>
+
+#include <QFile>
+
+#include <ppp/qt_util.hpp>
+
+std::optional<SourceFile> SourceFile::Open(const fs::path& path)
+{
+    const std::optional<FileStat> stat{ StatFile(path) };
+    if (!stat.has_value())
+    {
+        return std::nullopt;
+    }
+
+    SourceFile source_file{};
+    source_file.m_Path = path;
+    source_file.m_Stat = stat.value();
+    return source_file;
+}
+
+const fs::path& SourceFile::Path() const
+{
+    return m_Path;
+}
+
+const FileStat& SourceFile::Stat() const
+{
+    return m_Stat;
+}
+
+EncodedImageView SourceFile::Bytes()
+{
+    if (!m_Loaded)
+    {
+        m_Loaded = true;
+
+        // The file may be truncated while we read it, then we only keep what we got and decoding fails later
+        QFile file{ ToQString(m_Path) };
+        if (file.open(QFile::ReadOnly))
+        {
+            m_Bytes.resize(static_cast<size_t>(file.size()));
+            const qint64 read{ file.read(reinterpret_cast<char*>(m_Bytes.data()), file.size()) };
+            m_Bytes.resize(read < 0 ? 0 : static_cast<size_t>(read));
+        }
+    }
+    return m_Bytes;
+}
+
+const QByteArray& SourceFile::Hash()
+{
+    if (!m_Hash.has_value())
+    {
+        // Same as HashFile, an empty hash means the file could not be read
+        const EncodedImageView bytes{ Bytes() };
+        m_Hash = bytes.empty() && m_Stat.m_Size != 0 ? QByteArray{} : HashBytes(bytes);
+    }
+    return m_Hash.value();
+}
+
+void SourceFile::SetHash(QByteArray hash)
+{
+    m_Hash = std::move(hash);
+}
+
+Image SourceFile::Decode()
+{
+    const EncodedImageView bytes{ Bytes() };
+    if (bytes.empty())
+    {
+        return Image{};
+    }
+    return Image::Decode(bytes);
+}
@@ -19,6 +19,11 @@ consteval std::string_view JsonFormatVersion()
 }
 
 consteval std::string_view ImageDbFormatVersion()
+{
+    return "PPP00004";
+}
+
+consteval std::string_view DuplicateIndexFormatVersion()
 {
     return "PPP00002";
 }
@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+
+#include <ppp/project/bounded_queue.hpp>
+
+TEST_CASE("Bounded queue pops in push order across threads", "[bounded_queue_order]")
+{
+    BoundedQueue<std::unique_ptr<int>> queue{ 2 };
+
+    std::thread producer{
+        [&]()
+        {
+            for (int i = 0; i < 100; i++)
+            {
+                auto value{ std::make_unique<int>(i) };
+                queue.Push(std::move(value));
+            }
+        }
+    };
+
+    for (int i = 0; i < 100; i++)
+    {
+        auto value{ queue.Pop() };
+        REQUIRE(value.has_value());
+        REQUIRE(*value.value() == i);
+    }
+    producer.join();
+
+    REQUIRE(queue.TakePeakSize() <= queue.Capacity());
+}
+
+TEST_CASE("Bounded queue close", "[bounded_queue_close]")
+{
+    BoundedQueue<std::unique_ptr<int>> queue{ 2 };
+
+    auto first{ std::make_unique<int>(1) };
+    REQUIRE(queue.Push(std::move(first)));
+
+    auto left_over{ queue.Close() };
+    REQUIRE(left_over.size() == 1);
+    REQUIRE(*left_over.front() == 1);
+
+    // Values that could not be pushed are left untouched
+    auto second{ std::make_unique<int>(2) };
+    REQUIRE_FALSE(queue.Push(std::move(second)));
+    REQUIRE(second != nullptr);
+
+    REQUIRE_FALSE(queue.Pop().has_value());
+}
@@ -0,0 +1,174 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <ppp/color_cube.hpp>
+#include <ppp/image.hpp>
+#include <ppp/project/image_ops.hpp>
+
+// Straight-forward per-pixel floating point trilinear interpolation, as ApplyColorCube used to do it
+static cv::Mat ReferenceColorCube(const cv::Mat& input, const cv::Mat& color_cube)
+{
+    static constexpr auto c_LinearInterpolate{
+        [](float lhs, float rhs, float alpha)
+        {
+            return lhs * (1 - alpha) + rhs * alpha;
+        },
+    };
+
+    cv::Mat output{ input.clone() };
+    const int cube_size_minus_one{ color_cube.cols - 1 };
+    for (int y = 0; y < input.rows; y++)
+    {
+        for (int x = 0; x < input.cols; x++)
+        {
+            const cv::Vec3b col{ input.at<cv::Vec3b>(y, x) };
+            const float r{ (static_cast<float>(col[2]) / 255) * cube_size_minus_one };
+            const float g{ (static_cast<float>(col[1]) / 255) * cube_size_minus_one };
+            const float b{ (static_cast<float>(col[0]) / 255) * cube_size_minus_one };
+
+            const int r_lo{ static_cast<int>(std::floor(r)) };
+            const int r_hi{ static_cast<int>(std::ceil(r)) };
+            const int g_lo{ static_cast<int>(std::floor(g)) };
+            const int g_hi{ static_cast<int>(std::ceil(g)) };
+            const int b_lo{ static_cast<int>(std::floor(b)) };
+            const int b_hi{ static_cast<int>(std::ceil(b)) };
+
+            const float r_frac{ r - static_cast<float>(r_lo) };
+            const float g_frac{ g - static_cast<float>(g_lo) };
+            const float b_frac{ b - static_cast<float>(b_lo) };
+
+            auto& out_element{ output.at<cv::Vec3b>(y, x) };
+            for (int c = 0; c < 3; c++)
+            {
+                auto at{
+                    [&](int r, int g, int b)
+                    {
+                        return static_cast<float>(color_cube.at<cv::Vec3b>(r, g, b)[c]);
+                    }
+                };
+                const float x00{ c_LinearInterpolate(at(r_lo, g_lo, b_lo), at(r_hi, g_lo, b_lo), r_frac) };
+                const float x10{ c_LinearInterpolate(at(r_lo, g_hi, b_lo), at(r_hi, g_hi, b_lo), r_frac) };
+                const float x01{ c_LinearInterpolate(at(r_lo, g_lo, b_hi), at(r_hi, g_lo, b_hi), r_frac) };
+                const float x11{ c_LinearInterpolate(at(r_lo, g_hi, b_hi), at(r_hi, g_hi, b_hi), r_frac) };
+                const float y0{ c_LinearInterpolate(x00, x10, g_frac) };
+                const float y1{ c_LinearInterpolate(x01, x11, g_frac) };
+                out_element[c] = static_cast<uchar>(c_LinearInterpolate(y0, y1, b_frac));
+            }
+        }
+    }
+    return output;
+}
+
+TEST_CASE("Color cube matches per-pixel interpolation", "[color_cube_reference]")
+{
+#ifdef NDEBUG
+    const ColorCubeLattice lattice{ LoadColorCube("res/cubes/Foils Vibrance.CUBE") };
+    const ColorCube color_cube{ lattice };
+
+    // Every 8-bit color once, with an odd width so the scalar tail after the vector loop is covered too
+    cv::Mat all_colors{ 1 << 12, (1 << 12) + 7, CV_8UC3, cv::Scalar{ 0, 0, 0 } };
+    for (int i = 0; i < (1 << 24); i++)
+    {
+        all_colors.at<cv::Vec3b>(i >> 12, i & 0xfff) = cv::Vec3b{
+            static_cast<uchar>(i & 0xff),
+            static_cast<uchar>((i >> 8) & 0xff),
+            static_cast<uchar>((i >> 16) & 0xff),
+        };
+    }
+
+    const Image filtered{ Image{ all_colors }.ApplyColorCube(color_cube) };
+    const cv::Mat reference{ ReferenceColorCube(all_colors, lattice.m_Lattice) };
+
+    // Allow for one step of difference, the compiled cube interpolates with 8-bit fixed-point weights
+    cv::Mat difference;
+    cv::absdiff(filtered.GetUnderlying(), reference, difference);
+    double max_difference{};
+    cv::minMaxLoc(difference.reshape(1), nullptr, &max_difference);
+    REQUIRE(max_difference <= 1.0);
+#endif
+}
+
+TEST_CASE("Parse color cube", "[color_cube_parse]")
+{
+    static constexpr std::string_view c_ColorCube{
+        "# Comment before the title\r\n"
+        "TITLE \"Some title with spaces\"\r\n"
+        "\r\n"
+        "DOMAIN_MIN 0.0 0.0 0.0\r\n"
+        "DOMAIN_MAX 2.0 2.0 2.0\r\n"
+        "LUT_3D_SIZE 2\r\n"
+        "0.0 0.0 0.0\r\n"
+        "1.0 0.0 0.0\r\n"
+        "0.0 1.0 0.0\r\n"
+        "1.0 1.0 0.0\r\n"
+        "# Comment between data\r\n"
+        "0.0 0.0 1.0\r\n"
+        "1.0 0.0 1.0\r\n"
+        "0.0 1.0 1.0\r\n"
+        "1.0 1.0 1.0",
+    };
+
+    const ColorCubeLattice lattice{ ParseColorCube(c_ColorCube) };
+    REQUIRE(lattice.m_Lattice.cols == 2);
+    REQUIRE(lattice.m_DomainMax == std::array{ 2.0f, 2.0f, 2.0f });
+    REQUIRE(lattice.m_Lattice.ptr<cv::Vec3b>()[1] == cv::Vec3b{ 255, 0, 0 });
+    REQUIRE(lattice.m_Lattice.ptr<cv::Vec3b>()[7] == cv::Vec3b{ 255, 255, 255 });
+
+    // An identity lattice spanning twice the input range halves every value
+    const cv::Mat input{ 1, 2, CV_8UC3, cv::Scalar{ 100, 100, 100 } };
+    const Image filtered{ Image{ input }.ApplyColorCube(ColorCube{ lattice }) };
+#ifdef NDEBUG
+    const uchar halved{ filtered.GetUnderlying().at<cv::Vec3b>(0, 0)[0] };
+    REQUIRE(halved >= 49);
+    REQUIRE(halved <= 50);
+#endif
+
+    REQUIRE(ParseColorCube("LUT_3D_SIZE 2\n0.0 0.0 0.0\n").m_Lattice.empty());
+    REQUIRE(ParseColorCube("LUT_1D_SIZE 2\n0.0 0.0 0.0\n1.0 1.0 1.0\n").m_Lattice.empty());
+}
+
+TEST_CASE("Compiled color cube cache", "[color_cube_cache]")
+{
+    const fs::path cache_dir{ fs::temp_directory_path() / "ppp_color_cube_cache_test" };
+    fs::remove_all(cache_dir);
+
+    const ColorCube compiled{ LoadCompiledColorCube("tests/madness.CUBE", cache_dir) };
+    REQUIRE(compiled);
+    REQUIRE(std::distance(fs::directory_iterator{ cache_dir }, fs::directory_iterator{}) == 1);
+
+    const ColorCube cached{ LoadCompiledColorCube("tests/madness.CUBE", cache_dir) };
+    REQUIRE(cached);
+    REQUIRE(cached.Serialize() == compiled.Serialize());
+
+    const Image base_image{ Image::Read("fallback.png") };
+    REQUIRE(base_image.ApplyColorCube(cached).Hash() == base_image.ApplyColorCube(compiled).Hash());
+
+    fs::remove_all(cache_dir);
+}
+
+TEST_CASE("Color cube benchmark", "[.][color_cube_benchmark]")
+{
+    const ColorCubeLattice lattice{ LoadColorCube("res/cubes/Foils Vibrance.CUBE") };
+    const ColorCube color_cube{ lattice };
+
+    // Roughly the size of a card cropped at 1200 dpi
+    cv::Mat large_image;
+    cv::resize(Image::Read("fallback.png").GetUnderlying(), large_image, cv::Size{ 2976, 4152 });
+    if (large_image.channels() == 4)
+    {
+        cv::cvtColor(large_image, large_image, cv::COLOR_BGRA2BGR);
+    }
+
+    BENCHMARK("Per-pixel")
+    {
+        return ReferenceColorCube(large_image, lattice.m_Lattice);
+    };
+
+    BENCHMARK("ApplyColorCube")
+    {
+        return Image{ large_image }.ApplyColorCube(color_cube);
+    };
+}
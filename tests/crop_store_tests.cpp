@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ppp/project/crop_store.hpp>
+
+TEST_CASE("Crop store links identical crops", "[crop_store_link]")
+{
+    const fs::path crop_dir{ fs::temp_directory_path() / "ppp_crop_store_tests" };
+    fs::remove_all(crop_dir);
+    fs::create_directories(crop_dir);
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+    const QByteArray source_hash{ HashFile("fallback.png") };
+
+    const std::string key{ CropStore::Key(source_hash, params, 0_mm, "None", ".png") };
+    REQUIRE(key.ends_with(".png"));
+    REQUIRE(key == CropStore::Key(source_hash, params, 0_mm, "None", ".png"));
+    REQUIRE(key != CropStore::Key(source_hash, params, 1_mm, "None", ".png"));
+    REQUIRE(key != CropStore::Key(source_hash, params, 0_mm, "Vibrance", ".png"));
+
+    const CropStore store{ crop_dir };
+    REQUIRE_FALSE(store.Fetch(key, crop_dir / "card.png"));
+
+    fs::copy_file("fallback.png", crop_dir / "card.png");
+    REQUIRE(store.Put(key, crop_dir / "card.png"));
+
+    // The second card with the same art is served from the store
+    REQUIRE(store.Fetch(key, crop_dir / "card - Copy.png"));
+    REQUIRE(HashFile(crop_dir / "card - Copy.png") == source_hash);
+
+    // Nothing is pruned while outputs still link to the stored crop
+    REQUIRE(store.Prune() == 0);
+
+    fs::remove(crop_dir / "card.png");
+    fs::remove(crop_dir / "card - Copy.png");
+    REQUIRE(store.Prune() == 1);
+    REQUIRE_FALSE(store.Fetch(key, crop_dir / "card.png"));
+
+    fs::remove_all(crop_dir);
+}
@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ppp/project/decoded_image_cache.hpp>
+
+TEST_CASE("Decoded image cache hits on second read", "[decoded_image_cache_hit]")
+{
+    DecodedImageCache cache{ 64 * 1024 * 1024 };
+
+    const Image first{ cache.Read("fallback.png") };
+    const Image second{ cache.Read("fallback.png") };
+    REQUIRE(first.Hash() == second.Hash());
+
+    const DecodedImageCache::Stats stats{ cache.TakeStats() };
+    REQUIRE(stats.m_Hits == 1);
+    REQUIRE(stats.m_Misses == 1);
+    REQUIRE(stats.m_Entries == 1);
+
+    cache.Erase("fallback.png");
+    REQUIRE(cache.Read("fallback.png").Hash() == first.Hash());
+    REQUIRE(cache.TakeStats().m_Misses == 1);
+}
+
+TEST_CASE("Decoded image cache respects budget", "[decoded_image_cache_budget]")
+{
+    DecodedImageCache cache{ 1 };
+
+    REQUIRE(cache.Read("fallback.png").Valid());
+    REQUIRE(cache.Read("fallback.png").Valid());
+
+    const DecodedImageCache::Stats stats{ cache.TakeStats() };
+    REQUIRE(stats.m_Hits == 0);
+    REQUIRE(stats.m_Misses == 2);
+    REQUIRE(stats.m_Entries == 0);
+    REQUIRE(stats.m_Bytes == 0);
+}
+
+TEST_CASE("Decoded image cache decodes the bytes a source was hashed from", "[decoded_image_cache_source]")
+{
+    DecodedImageCache cache{ 64 * 1024 * 1024 };
+
+    std::optional<SourceFile> source{ SourceFile::Open("fallback.png") };
+    REQUIRE(source.has_value());
+    REQUIRE(source->Stat() == StatFile("fallback.png"));
+    REQUIRE(source->Hash() == HashFile("fallback.png"));
+
+    const Image image{ cache.Read(source.value()) };
+    REQUIRE(image.Hash() == Image::Read("fallback.png").Hash());
+
+    // Cached by path, so reading by path afterwards is a hit
+    REQUIRE(cache.Read("fallback.png").Hash() == image.Hash());
+    REQUIRE(cache.TakeStats().m_Hits == 1);
+
+    REQUIRE_FALSE(SourceFile::Open("does_not_exist.png").has_value());
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ppp/image.hpp>
+#include <ppp/project/duplicate_index.hpp>
+
+TEST_CASE("Duplicate index groups identical images", "[duplicate_index_groups]")
+{
+    const fs::path image_dir{ fs::temp_directory_path() / "ppp_duplicate_index_tests" };
+    fs::remove_all(image_dir);
+    fs::create_directories(image_dir);
+
+    const fs::path index_path{ image_dir / DuplicateIndex::c_FileName };
+
+    fs::copy_file("fallback.png", image_dir / "card.png");
+    fs::copy_file("fallback.png", image_dir / "card - Copy.png");
+    REQUIRE(Image::Read("fallback.png").Rotate(Image::Rotation::Degree180).Write(image_dir / "other.png"));
+
+    {
+        const DuplicateIndex index{ DuplicateIndex::Build(image_dir, index_path, false) };
+        REQUIRE(index.Canonical("card.png") == "card.png");
+        REQUIRE(index.Canonical("card - Copy.png") == "card.png");
+        REQUIRE(index.Canonical("other.png") == "other.png");
+        REQUIRE(index.Duplicates("card.png") == std::vector<fs::path>{ "card - Copy.png" });
+        REQUIRE(index.Duplicates("other.png").empty());
+
+        // The content hash can stand in for hashing the source again as long as it did not change
+        const FileStat card_stat{ StatFile(image_dir / "card.png").value() };
+        REQUIRE(index.ContentHash("card.png", card_stat) == HashFile(image_dir / "card.png"));
+        REQUIRE(index.ContentHash("card.png", FileStat{}).isEmpty());
+
+        const DuplicateIndex::Report& report{ index.GetReport() };
+        REQUIRE(report.m_Images == 3);
+        REQUIRE(report.m_Hashed == 3);
+        REQUIRE(report.m_Groups == 1);
+        REQUIRE(report.m_Duplicates == 1);
+        REQUIRE(report.m_DuplicateBytes == fs::file_size("fallback.png"));
+
+        index.Write(index_path);
+    }
+
+    {
+        // Only reading doesn't hash anything, but knows all duplicates
+        const DuplicateIndex index{ DuplicateIndex::Read(index_path) };
+        REQUIRE(index.Canonical("card - Copy.png") == "card.png");
+        REQUIRE(index.GetReport().m_Duplicates == 1);
+    }
+
+    {
+        // Nothing changed on disk, so nothing is hashed again
+        DuplicateIndex index{ DuplicateIndex::Build(image_dir, index_path, false) };
+        REQUIRE(index.GetReport().m_Hashed == 0);
+        REQUIRE(index.Canonical("card - Copy.png") == "card.png");
+
+        // Once the canonical image is gone the next one takes its place
+        fs::remove(image_dir / "card.png");
+        index.Update(image_dir, "card.png");
+        REQUIRE(index.Canonical("card - Copy.png") == "card - Copy.png");
+        REQUIRE(index.GetReport().m_Duplicates == 0);
+    }
+
+    fs::remove_all(image_dir);
+}
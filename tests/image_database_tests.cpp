@@ -0,0 +1,388 @@
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <fmt/format.h>
+
+#include <nlohmann/json.hpp>
+
+#include <ppp/project/image_database.hpp>
+#include <ppp/version.hpp>
+
+TEST_CASE("Image database replays journal", "[image_database_journal]")
+{
+    const fs::path db_dir{ fs::temp_directory_path() / "ppp_image_db_tests" };
+    fs::remove_all(db_dir);
+    fs::create_directories(db_dir);
+
+    const fs::path db_path{ db_dir / ".image.db" };
+    const fs::path journal_path{ db_dir / ".image.db.journal" };
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        image_db.PutEntry(db_dir / "a.png", SourceVersion{ .m_Hash{ "hash_a" } }, params);
+        image_db.PutEntry(db_dir / "b.png", SourceVersion{ .m_Hash{ "hash_b" } }, params);
+
+        // Never written, entries only exist in the journal
+        REQUIRE_FALSE(fs::exists(db_path));
+        REQUIRE(fs::exists(journal_path));
+
+        // Records are buffered until flushed
+        const auto header_size{ fs::file_size(journal_path) };
+        image_db.FlushJournal();
+        REQUIRE(fs::file_size(journal_path) > header_size);
+    }
+
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        REQUIRE(image_db.FindEntry(db_dir / "a.png"));
+        REQUIRE(image_db.FindEntry(db_dir / "b.png"));
+        REQUIRE_FALSE(image_db.FindEntry(db_dir / "c.png"));
+
+        // Replaying compacts into the snapshot
+        REQUIRE(fs::exists(db_path));
+    }
+
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        REQUIRE(image_db.FindEntry(db_dir / "a.png"));
+        REQUIRE(image_db.FindEntry(db_dir / "b.png"));
+    }
+
+    fs::remove_all(db_dir);
+}
+
+TEST_CASE("Image database only hashes touched sources", "[image_database_stat]")
+{
+    const fs::path db_dir{ fs::temp_directory_path() / "ppp_image_db_stat_tests" };
+    fs::remove_all(db_dir);
+    fs::create_directories(db_dir);
+
+    const fs::path source{ db_dir / "source.png" };
+    const fs::path destination{ db_dir / "destination.png" };
+    fs::copy_file("fallback.png", source);
+    fs::copy_file("fallback.png", destination);
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+
+    ImageDataBase image_db{ ImageDataBase::Read(db_dir / ".image.db") };
+
+    std::optional<SourceVersion> source_version{ image_db.TestEntry(destination, source, params) };
+    REQUIRE(source_version.has_value());
+    REQUIRE(source_version->m_Hash == HashFile(source));
+    REQUIRE(source_version->m_Stat == StatFile(source));
+    image_db.PutEntry(destination, std::move(source_version).value(), params);
+    REQUIRE_FALSE(image_db.TestEntry(destination, source, params).has_value());
+
+    const auto flip_byte{
+        [&]()
+        {
+            std::fstream file{ source, std::ios::in | std::ios::out | std::ios::binary };
+            file.seekg(64);
+            const char byte{ static_cast<char>(file.get()) };
+            file.seekp(64);
+            file.put(static_cast<char>(~byte));
+        }
+    };
+
+    // Stat changed but the contents are the same, nothing to do
+    const fs::file_time_type touched_time{ fs::last_write_time(source) + std::chrono::seconds{ 10 } };
+    fs::last_write_time(source, touched_time);
+    REQUIRE_FALSE(image_db.TestEntry(destination, source, params).has_value());
+
+    // The new stat was remembered, so the source is trusted without hashing it again, which
+    // we can tell by sneaking in a change that keeps size, inode and modification time
+    flip_byte();
+    fs::last_write_time(source, touched_time);
+    REQUIRE_FALSE(image_db.TestEntry(destination, source, params).has_value());
+    flip_byte();
+    fs::last_write_time(source, touched_time);
+
+    // Same size but different contents
+    flip_byte();
+    fs::last_write_time(source, fs::last_write_time(source) + std::chrono::seconds{ 10 });
+    source_version = image_db.TestEntry(destination, source, params);
+    REQUIRE(source_version.has_value());
+    REQUIRE(source_version->m_Hash != HashFile("fallback.png"));
+
+    image_db.PutEntry(destination, std::move(source_version).value(), params);
+    REQUIRE_FALSE(image_db.TestEntry(destination, source, params).has_value());
+
+    fs::remove_all(db_dir);
+}
+
+TEST_CASE("Image database snapshot is binary and migrates json", "[image_database_binary]")
+{
+    const fs::path db_dir{ fs::temp_directory_path() / "ppp_image_db_binary_tests" };
+    fs::remove_all(db_dir);
+    fs::create_directories(db_dir);
+
+    const fs::path db_path{ db_dir / ".image.db" };
+
+    const auto read_version{
+        [&]()
+        {
+            std::string version(ImageDbFormatVersion().size(), '\0');
+            std::ifstream{ db_path, std::ios::binary }.read(version.data(), version.size());
+            return version;
+        }
+    };
+
+    // Snapshot as written before the binary format
+    {
+        const nlohmann::json entry{
+            { "hash", nlohmann::json::binary_t{ std::vector<uint8_t>{ 1, 2, 3 } } },
+            { "stat", { { "size", 4 }, { "time", 5 }, { "inode", 6 } } },
+            { "dpi", 600 },
+            { "width", 0 },
+            { "card_size", { { "width", 63000 }, { "height", 88000 } } },
+            { "card_input_bleed", 3000 },
+        };
+
+        nlohmann::json json{};
+        json["version"] = "PPP00003";
+        json["db"] = std::unordered_map<fs::path, nlohmann::json>{ { db_dir / "a.png", entry } };
+        std::ofstream{ db_path } << json;
+    }
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        REQUIRE(image_db.FindEntry(db_dir / "a.png"));
+        REQUIRE(read_version() == ImageDbFormatVersion());
+
+        for (int i = 0; i < 1000; i++)
+        {
+            image_db.PutEntry(db_dir / fmt::format("{}.png", i), SourceVersion{ .m_Hash{ QByteArray::number(i) } }, params);
+        }
+        image_db.Write(db_path);
+    }
+
+    {
+        const ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        REQUIRE(image_db.FindEntry(db_dir / "a.png"));
+        for (int i = 0; i < 1000; i++)
+        {
+            REQUIRE(image_db.FindEntry(db_dir / fmt::format("{}.png", i)));
+        }
+        REQUIRE_FALSE(image_db.FindEntry(db_dir / "1000.png"));
+        REQUIRE_FALSE(image_db.FindEntry(db_dir / "b.png"));
+    }
+
+    fs::remove_all(db_dir);
+}
+
+TEST_CASE("Image database can be used from many threads", "[image_database_concurrent]")
+{
+    const fs::path db_dir{ fs::temp_directory_path() / "ppp_image_db_concurrent_tests" };
+    fs::remove_all(db_dir);
+    fs::create_directories(db_dir);
+
+    const fs::path db_path{ db_dir / ".image.db" };
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+
+    static constexpr size_t c_NumThreads{ 8 };
+    static constexpr size_t c_EntriesPerThread{ 250 };
+
+    std::atomic_size_t missing_entries{ 0 };
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < c_NumThreads; t++)
+        {
+            threads.emplace_back(
+                [&, t]()
+                {
+                    for (size_t i = 0; i < c_EntriesPerThread; i++)
+                    {
+                        const fs::path destination{ db_dir / fmt::format("{}_{}.png", t, i) };
+                        image_db.PutEntry(destination, SourceVersion{ .m_Hash{ QByteArray::number(i) } }, params);
+                        if (!image_db.FindEntry(destination))
+                        {
+                            missing_entries++;
+                        }
+                    }
+                });
+        }
+
+        // Snapshot while the workers are still putting, nothing may get lost in between
+        image_db.Write(db_path);
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+    REQUIRE(missing_entries == 0);
+
+    const ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+    for (size_t t = 0; t < c_NumThreads; t++)
+    {
+        for (size_t i = 0; i < c_EntriesPerThread; i++)
+        {
+            REQUIRE(image_db.FindEntry(db_dir / fmt::format("{}_{}.png", t, i)));
+        }
+    }
+
+    fs::remove_all(db_dir);
+}
+
+TEST_CASE("Image database contention benchmark", "[.][image_database_benchmark]")
+{
+    const fs::path db_dir{ fs::temp_directory_path() / "ppp_image_db_benchmark" };
+    fs::remove_all(db_dir);
+    fs::create_directories(db_dir);
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+
+    static constexpr size_t c_NumEntries{ 4096 };
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_dir / ".image.db") };
+        for (size_t i = 0; i < c_NumEntries; i++)
+        {
+            image_db.PutEntry(db_dir / fmt::format("{}.png", i), SourceVersion{ .m_Hash{ QByteArray::number(i) } }, params);
+        }
+        image_db.Write(db_dir / ".image.db");
+    }
+
+    ImageDataBase image_db{ ImageDataBase::Read(db_dir / ".image.db") };
+    std::shared_mutex global_mutex;
+
+    // Roughly what a crop worker does, a few lookups for every put
+    const auto run_workers{
+        [&](bool global_lock)
+        {
+            const size_t num_threads{ std::max(std::thread::hardware_concurrency(), 2u) };
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < num_threads; t++)
+            {
+                threads.emplace_back(
+                    [&, t]()
+                    {
+                        for (size_t i = t; i < c_NumEntries; i += num_threads)
+                        {
+                            const fs::path destination{ db_dir / fmt::format("{}.png", i) };
+                            for (size_t j = 0; j < 4; j++)
+                            {
+                                std::optional<std::shared_lock<std::shared_mutex>> lock;
+                                if (global_lock)
+                                {
+                                    lock.emplace(global_mutex);
+                                }
+                                std::ignore = image_db.FindEntry(destination);
+                            }
+
+                            std::optional<std::unique_lock<std::shared_mutex>> lock;
+                            if (global_lock)
+                            {
+                                lock.emplace(global_mutex);
+                            }
+                            image_db.PutEntry(destination, SourceVersion{ .m_Hash{ QByteArray::number(i + 1) } }, params);
+                        }
+                    });
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+        }
+    };
+
+    BENCHMARK("Global lock")
+    {
+        run_workers(true);
+    };
+
+    BENCHMARK("Sharded")
+    {
+        run_workers(false);
+    };
+
+    fs::remove_all(db_dir);
+}
+
+TEST_CASE("Image database migrates MD5 entries without trusting them", "[image_database_legacy]")
+{
+    const fs::path db_dir{ fs::temp_directory_path() / "ppp_image_db_legacy_tests" };
+    fs::remove_all(db_dir);
+    fs::create_directories(db_dir);
+
+    const fs::path db_path{ db_dir / ".image.db" };
+    const fs::path source{ db_dir / "source.png" };
+    const fs::path destination{ db_dir / "destination.png" };
+    fs::copy_file("fallback.png", source);
+    fs::copy_file("fallback.png", destination);
+
+    // Snapshot as written before we stored the stat, even a hash that happens to match is not trusted
+    {
+        const QByteArray hash{ HashFile(source) };
+        const nlohmann::json entry{
+            { "hash", nlohmann::json::binary_t{ std::vector<uint8_t>{ hash.begin(), hash.end() } } },
+            { "dpi", 600 },
+            { "width", 0 },
+            { "card_size", { { "width", 63000 }, { "height", 88000 } } },
+            { "card_input_bleed", 3000 },
+        };
+
+        nlohmann::json json{};
+        json["version"] = "PPP00002";
+        json["db"] = std::unordered_map<fs::path, nlohmann::json>{ { destination, entry } };
+        std::ofstream{ db_path } << json;
+    }
+
+    const ImageParameters params{
+        .m_DPI{ 600_dpi },
+        .m_CardSize{ 63_mm, 88_mm },
+        .m_FullBleedEdge{ 3_mm },
+    };
+
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        REQUIRE(image_db.FindEntry(destination));
+        REQUIRE(image_db.TestEntry(destination, source, params).has_value());
+    }
+
+    // Migrated right away, the marker survives the binary snapshot
+    {
+        ImageDataBase image_db{ ImageDataBase::Read(db_path) };
+        REQUIRE(image_db.FindEntry(destination));
+
+        std::optional<SourceVersion> source_version{ image_db.TestEntry(destination, source, params) };
+        REQUIRE(source_version.has_value());
+
+        image_db.PutEntry(destination, std::move(source_version).value(), params);
+        REQUIRE_FALSE(image_db.TestEntry(destination, source, params).has_value());
+    }
+
+    fs::remove_all(db_dir);
+}
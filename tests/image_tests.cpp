@@ -1,5 +1,10 @@
+#include <atomic>
+
 #include <catch2/catch_test_macros.hpp>
 
+#include <opencv2/core.hpp>
+
+#include <ppp/color_cube.hpp>
 #include <ppp/constants.hpp>
 #include <ppp/image.hpp>
 #include <ppp/project/image_ops.hpp>
@@ -71,7 +76,7 @@ TEST_CASE("Uncrop image", "[image_uncrop]")
 TEST_CASE("Apply color cube", "[image_color_cube]")
 {
     {
-        const cv::Mat vibrance_cube{ LoadColorCube("res/cubes/Foils Vibrance.CUBE") };
+        const ColorCube vibrance_cube{ LoadColorCube("res/cubes/Foils Vibrance.CUBE") };
         const Image filtered_image{ g_BaseImage.ApplyColorCube(vibrance_cube) };
         REQUIRE(filtered_image.Width() == 248_pix);
         REQUIRE(filtered_image.Height() == 322_pix);
@@ -85,7 +90,7 @@ TEST_CASE("Apply color cube", "[image_color_cube]")
     }
 
     {
-        const cv::Mat madness_cube{ LoadColorCube("tests/madness.CUBE") };
+        const ColorCube madness_cube{ LoadColorCube("tests/madness.CUBE") };
         const Image filtered_image{ g_BaseImage.ApplyColorCube(madness_cube) };
         REQUIRE(filtered_image.Width() == 248_pix);
         REQUIRE(filtered_image.Height() == 322_pix);
@@ -115,9 +120,203 @@ TEST_CASE("Grow image", "[image_resize_grow]")
     REQUIRE(resized_image.Hash() == 0x1892b36349d83626);
 }
 
+TEST_CASE("Read scaled image", "[image_read_scaled]")
+{
+    const fs::path temp_dir{ fs::temp_directory_path() / "ppp_read_scaled_test" };
+    fs::create_directories(temp_dir);
+
+    // Large enough that both the reduced JPEG decode and the pyramid kick in
+    const Image large_image{ g_BaseImage.Resize({ 992_pix, 1288_pix }) };
+    for (const fs::path& file : { temp_dir / "large.jpg", temp_dir / "large.png" })
+    {
+        REQUIRE(large_image.Write(file));
+
+        const Image scaled_image{ Image::ReadScaled(file, { 62_pix, 80_pix }) };
+        const Image reference_image{ Image::Read(file).Resize({ 62_pix, 80_pix }) };
+        REQUIRE(scaled_image.Width() == 62_pix);
+        REQUIRE(scaled_image.Height() == 80_pix);
+        REQUIRE(scaled_image.GetUnderlying().type() == reference_image.GetUnderlying().type());
+
+        cv::Mat difference;
+        cv::absdiff(scaled_image.GetUnderlying(), reference_image.GetUnderlying(), difference);
+        REQUIRE(cv::mean(difference.reshape(1))[0] < 4.0);
+    }
+
+    fs::remove_all(temp_dir);
+}
+
 TEST_CASE("Calculate DPI", "[image_dpi]")
 {
     const auto card_size_info{ g_Cfg.m_CardSizes.at(g_Cfg.m_DefaultCardSize) };
     const auto dpi{ g_BaseImage.Density(card_size_info.m_CardSize.m_Dimensions + 2.0f * card_size_info.m_InputBleed.m_Dimension) * card_size_info.m_CardSizeScale * 1_in };
     REQUIRE(static_cast<int>(dpi.value) == 87);
 }
+
+TEST_CASE("Round image corners", "[image_round_corners]")
+{
+    const Size card_size{ 2.48_in, 3.46_in };
+    const Image rounded{ g_BaseImage.RoundCorners(card_size, 2.5_mm) };
+    const cv::Mat& rounded_impl{ rounded.GetUnderlying() };
+    REQUIRE(rounded_impl.channels() == 4);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(0, 0)[3] == 0);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(0, rounded_impl.cols - 1)[3] == 0);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(rounded_impl.rows - 1, 0)[3] == 0);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(rounded_impl.rows - 1, rounded_impl.cols - 1)[3] == 0);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(rounded_impl.rows / 2, rounded_impl.cols / 2)[3] == 255);
+
+    // Same stencil as the fused transform
+    const Image transformed{
+        TransformImage(g_BaseImage,
+                       ImageTransform{
+                           .m_CardSize{ card_size },
+                           .m_CornerRadius{ 2.5_mm },
+                       }),
+    };
+    cv::Mat rounded_alpha;
+    cv::Mat transformed_alpha;
+    cv::extractChannel(rounded_impl, rounded_alpha, 3);
+    cv::extractChannel(transformed.GetUnderlying(), transformed_alpha, 3);
+    REQUIRE(cv::norm(rounded_alpha, transformed_alpha, cv::NORM_INF) == 0.0);
+
+    // Rounding an already rounded image multiplies alpha, so fully transparent pixels stay transparent
+    const cv::Mat& twice_impl{ rounded.RoundCorners(card_size, 2.5_mm).GetUnderlying() };
+    REQUIRE(twice_impl.at<cv::Vec4b>(0, 0)[3] == 0);
+    REQUIRE(twice_impl.at<cv::Vec4b>(twice_impl.rows / 2, twice_impl.cols / 2)[3] == 255);
+
+    // The stencil is built once per radius
+    REQUIRE(Image::CornerStencil(12).data == Image::CornerStencil(12).data);
+}
+
+TEST_CASE("Transform image in one pass", "[image_transform]")
+{
+    const ColorCube vibrance_cube{ LoadColorCube("res/cubes/Foils Vibrance.CUBE") };
+    const ImageTransform transform{
+        .m_CropLeft{ 10_pix },
+        .m_CropTop{ 12_pix },
+        .m_CropRight{ 14_pix },
+        .m_CropBottom{ 16_pix },
+        .m_Size{ 150_pix, 200_pix },
+        .m_ColorCube = &vibrance_cube,
+        .m_Rotation = Image::Rotation::Degree90,
+    };
+
+    const Image fused{ TransformImage(g_BaseImage, transform) };
+    const Image separate{
+        g_BaseImage
+            .Crop(10_pix, 12_pix, 14_pix, 16_pix)
+            .Resize({ 150_pix, 200_pix })
+            .ApplyColorCube(vibrance_cube)
+            .Rotate(Image::Rotation::Degree90)
+    };
+    REQUIRE(fused.Width() == 200_pix);
+    REQUIRE(fused.Height() == 150_pix);
+    REQUIRE(fused.GetUnderlying().type() == separate.GetUnderlying().type());
+
+    // Resampling is not bit-exact to OpenCV's, but has to be visually the same
+    cv::Mat difference;
+    cv::absdiff(fused.GetUnderlying(), separate.GetUnderlying(), difference);
+    REQUIRE(cv::mean(difference.reshape(1))[0] < 1.0);
+
+    // Rounding corners adds alpha, transparent in the corners and opaque everywhere else
+    const Image rounded{
+        TransformImage(g_BaseImage,
+                       ImageTransform{
+                           .m_CardSize{ 2.48_in, 3.46_in },
+                           .m_CornerRadius{ 2.5_mm },
+                       }),
+    };
+    const cv::Mat& rounded_impl{ rounded.GetUnderlying() };
+    REQUIRE(rounded_impl.channels() == 4);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(0, 0)[3] == 0);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(rounded_impl.rows - 1, rounded_impl.cols - 1)[3] == 0);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(0, rounded_impl.cols / 2)[3] == 255);
+    REQUIRE(rounded_impl.at<cv::Vec4b>(rounded_impl.rows / 2, rounded_impl.cols / 2)[3] == 255);
+
+    // 16-bit sources come out the same as their 8-bit counterpart
+    cv::Mat base_16_bit;
+    g_BaseImage.GetUnderlying().convertTo(base_16_bit, CV_16U, 257.0);
+    const Image fused_16_bit{ TransformImage(Image{ base_16_bit }, transform) };
+    REQUIRE(fused_16_bit.GetUnderlying().type() == fused.GetUnderlying().type());
+
+    cv::Mat difference_16_bit;
+    cv::absdiff(fused_16_bit.GetUnderlying(), fused.GetUnderlying(), difference_16_bit);
+    REQUIRE(cv::mean(difference_16_bit.reshape(1))[0] < 1.0);
+}
+
+// Forwards to OpenCV's default allocator, counting every pixel buffer allocated
+class CountingAllocator : public cv::MatAllocator
+{
+  public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override
+    {
+        if (data == nullptr)
+        {
+            m_Allocations++;
+        }
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override
+    {
+        return cv::Mat::getStdAllocator()->allocate(data, access_flags, usage_flags);
+    }
+    void deallocate(cv::UMatData* data) const override
+    {
+        cv::Mat::getStdAllocator()->deallocate(data);
+    }
+
+    mutable std::atomic_uint32_t m_Allocations{ 0 };
+};
+
+TEST_CASE("Copying images shares pixels", "[image_copy_on_write]")
+{
+    CountingAllocator allocator{};
+    cv::Mat::setDefaultAllocator(&allocator);
+    AtScopeExit restore_allocator{
+        []()
+        {
+            cv::Mat::setDefaultAllocator(nullptr);
+        }
+    };
+
+    const Image source{ Image::Read("fallback.png") };
+    const auto card_size_info{ g_Cfg.m_CardSizes.at(g_Cfg.m_DefaultCardSize) };
+    const Size card_size{ card_size_info.m_CardSize.m_Dimensions };
+    const Length full_bleed{ card_size_info.m_InputBleed.m_Dimension };
+
+    {
+        // Crop path, cropping is a view and neither of these transformations changes anything
+        allocator.m_Allocations = 0;
+        const Image cropped{ CropImage(source, "fallback.png", card_size, full_bleed, 0_mm, 1200_dpi) };
+        const Image rotated{ cropped.Rotate(Image::Rotation::None) };
+        const Image rounded{ rotated.RoundCorners(card_size, 1_mm) };
+        REQUIRE(allocator.m_Allocations == 0);
+    }
+
+    {
+        // Preview path, once resized passing previews around by value does not allocate
+        const Image resized{ source.Resize({ 124_pix, 161_pix }) };
+        allocator.m_Allocations = 0;
+        ImagePreview preview{};
+        preview.m_UncroppedImage = resized;
+        preview.m_CroppedImage = CropImage(resized, "fallback.png", card_size, full_bleed, 0_mm, 1200_dpi);
+        const ImagePreview signalled_preview{ preview };
+        const ImgDict previews{ { "fallback.png", signalled_preview } };
+        REQUIRE(allocator.m_Allocations == 0);
+    }
+
+    {
+        allocator.m_Allocations = 0;
+        Image copy{ source };
+        REQUIRE(copy.GetUnderlying().data == source.GetUnderlying().data);
+
+        const Image clone{ source.Clone() };
+        REQUIRE(clone.GetUnderlying().data != source.GetUnderlying().data);
+        REQUIRE(allocator.m_Allocations == 1);
+
+        // Writing detaches from the shared pixels once, after that the pixels are our own
+        REQUIRE(copy.GetMutableUnderlying().data != source.GetUnderlying().data);
+        REQUIRE(allocator.m_Allocations == 2);
+        copy.GetMutableUnderlying();
+        REQUIRE(allocator.m_Allocations == 2);
+    }
+}
@@ -0,0 +1,37 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ppp/project/metrics.hpp>
+
+TEST_CASE("Metrics registry records timings, counters and gauges", "[metrics_record]")
+{
+    MetricsRegistry metrics{};
+
+    metrics.RecordTiming("crop.stage.Decode", std::chrono::milliseconds{ 4 });
+    metrics.RecordTiming("crop.stage.Decode", std::chrono::milliseconds{ 2 });
+    {
+        MetricsRegistry::ScopedTimer timer{ metrics, "crop.hash" };
+    }
+    metrics.AddCount("crop.jobs.done");
+    metrics.AddCount("crop.jobs.done", 2);
+    metrics.SetGauge("image_cache.hit_rate", 0.5);
+
+    const auto decode{ metrics.GetTiming("crop.stage.Decode") };
+    REQUIRE(decode.has_value());
+    REQUIRE(decode->m_Count == 2);
+    REQUIRE(decode->m_Total == std::chrono::milliseconds{ 6 });
+    REQUIRE(decode->m_Min == std::chrono::milliseconds{ 2 });
+    REQUIRE(decode->m_Max == std::chrono::milliseconds{ 4 });
+
+    REQUIRE(metrics.GetTiming("crop.hash").has_value());
+    REQUIRE_FALSE(metrics.GetTiming("crop.stage.Write").has_value());
+    REQUIRE(metrics.GetCount("crop.jobs.done") == 3);
+    REQUIRE(metrics.GetGauge("image_cache.hit_rate") == 0.5);
+
+    const std::string json{ metrics.DumpJson() };
+    REQUIRE(json.find("crop.stage.Decode") != std::string::npos);
+    REQUIRE(json.find("image_cache.hit_rate") != std::string::npos);
+
+    metrics.Reset();
+    REQUIRE_FALSE(metrics.GetTiming("crop.stage.Decode").has_value());
+    REQUIRE(metrics.GetCount("crop.jobs.done") == 0);
+}
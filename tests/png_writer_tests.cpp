@@ -0,0 +1,112 @@
+#include <cstring>
+#include <fstream>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <ppp/image.hpp>
+#include <ppp/png_writer.hpp>
+
+TEST_CASE("Write png with density", "[png_writer_phys]")
+{
+    const fs::path png_path{ fs::temp_directory_path() / "ppp_png_writer_test.png" };
+    const Image base_image{ Image::Read("fallback.png") };
+    const PngWriteOptions options{
+        .m_Compression{ 3 },
+        .m_Density{ 120_dpi },
+    };
+    REQUIRE(WritePng(png_path, base_image.GetUnderlying(), options));
+
+    // Writing to a file and to memory has to produce the same stream
+    const EncodedImage encoded{ EncodePng(base_image.GetUnderlying(), options) };
+    std::ifstream file{ png_path, std::ios::binary };
+    const std::vector<char> written{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    REQUIRE(written.size() == encoded.size());
+    REQUIRE(std::memcmp(written.data(), encoded.data(), encoded.size()) == 0);
+
+    // pHYs has to come before the first IDAT and hold the density in dots per meter
+    const std::string_view stream{ written.data(), written.size() };
+    const size_t phys_idx{ stream.find("pHYs") };
+    REQUIRE(phys_idx != std::string_view::npos);
+    REQUIRE(phys_idx < stream.find("IDAT"));
+    const auto read_u32{
+        [&](size_t idx)
+        {
+            return static_cast<uint32_t>(static_cast<uint8_t>(stream[idx])) << 24 |
+                   static_cast<uint32_t>(static_cast<uint8_t>(stream[idx + 1])) << 16 |
+                   static_cast<uint32_t>(static_cast<uint8_t>(stream[idx + 2])) << 8 |
+                   static_cast<uint32_t>(static_cast<uint8_t>(stream[idx + 3]));
+        }
+    };
+    const auto dots_per_meter{ static_cast<uint32_t>(options.m_Density.value().value) };
+    REQUIRE(dots_per_meter == 4724);
+    REQUIRE(read_u32(phys_idx + 4) == dots_per_meter);
+    REQUIRE(read_u32(phys_idx + 8) == dots_per_meter);
+    REQUIRE(stream[phys_idx + 12] == 1);
+
+    // Lossless round trip
+    const Image read_image{ Image::Read(png_path) };
+    REQUIRE(read_image.GetUnderlying().type() == base_image.GetUnderlying().type());
+    REQUIRE(cv::norm(read_image.GetUnderlying(), base_image.GetUnderlying(), cv::NORM_INF) == 0.0);
+
+    file.close();
+    fs::remove(png_path);
+}
+
+TEST_CASE("Write png in parallel chunks", "[png_writer_parallel]")
+{
+    cv::Mat large_image;
+    cv::resize(Image::Read("fallback.png").GetUnderlying(), large_image, cv::Size{ 1488, 2076 });
+
+    cv::Mat large_image_16;
+    large_image.convertTo(large_image_16, CV_16U, 257.0);
+
+    for (const cv::Mat& image : { large_image, large_image_16 })
+    {
+        for (const std::optional<int32_t> compression : { std::optional<int32_t>{}, std::optional<int32_t>{ 6 } })
+        {
+            const EncodedImage encoded{
+                EncodePng(image,
+                          PngWriteOptions{
+                              .m_Compression{ compression },
+                              .m_Strategy = PngStrategy::Filtered,
+                              .m_Parallel = true,
+                              .m_Density{ 300_dpi },
+                          }),
+            };
+            REQUIRE(!encoded.empty());
+
+            const Image decoded{ Image::Decode(encoded) };
+            REQUIRE(decoded.GetUnderlying().type() == image.type());
+            REQUIRE(cv::norm(decoded.GetUnderlying(), image, cv::NORM_INF) == 0.0);
+        }
+    }
+}
+
+TEST_CASE("Png writer benchmark", "[.][png_writer_benchmark]")
+{
+    // Roughly the size of a card cropped at 1200 dpi
+    cv::Mat large_image;
+    cv::resize(Image::Read("fallback.png").GetUnderlying(), large_image, cv::Size{ 2976, 4152 });
+
+    BENCHMARK("cv::imencode")
+    {
+        std::vector<uchar> buffer;
+        cv::imencode(".png", large_image, buffer, { cv::IMWRITE_PNG_COMPRESSION, 3 });
+        return buffer;
+    };
+
+    BENCHMARK("EncodePng")
+    {
+        return EncodePng(large_image, PngWriteOptions{ .m_Compression{ 3 } });
+    };
+
+    BENCHMARK("EncodePng parallel")
+    {
+        return EncodePng(large_image, PngWriteOptions{ .m_Compression{ 3 }, .m_Parallel = true });
+    };
+}
@@ -0,0 +1,152 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <ppp/project/work_queue.hpp>
+
+TEST_CASE("Work queue pops in insertion order", "[work_queue_order]")
+{
+    WorkQueue queue{};
+    REQUIRE(queue.Push("a.png"));
+    REQUIRE(queue.Push("b.png"));
+    REQUIRE(queue.Push("c.png"));
+    REQUIRE(queue.Size() == 3);
+
+    REQUIRE(queue.Pop() == "a.png"_p);
+    REQUIRE(queue.Pop() == "b.png"_p);
+    REQUIRE(queue.Pop() == "c.png"_p);
+    REQUIRE(queue.Empty());
+    REQUIRE_FALSE(queue.Pop().has_value());
+}
+
+TEST_CASE("Work queue deduplicates", "[work_queue_dedupe]")
+{
+    WorkQueue queue{};
+    REQUIRE(queue.Push("a.png"));
+    REQUIRE_FALSE(queue.Push("a.png"));
+    REQUIRE(queue.Size() == 1);
+
+    REQUIRE(queue.Pop() == "a.png"_p);
+    REQUIRE(queue.Push("a.png"));
+}
+
+TEST_CASE("Work queue removes", "[work_queue_remove]")
+{
+    WorkQueue queue{};
+    queue.Push("a.png");
+    queue.Push("b.png");
+    queue.Push("c.png");
+
+    REQUIRE(queue.Remove("b.png"));
+    REQUIRE_FALSE(queue.Remove("b.png"));
+    REQUIRE_FALSE(queue.Contains("b.png"));
+
+    REQUIRE(queue.Pop() == "a.png"_p);
+    REQUIRE(queue.Pop() == "c.png"_p);
+}
+
+TEST_CASE("Work queue moves to front", "[work_queue_move_to_front]")
+{
+    WorkQueue queue{};
+    queue.Push("a.png");
+    queue.Push("b.png");
+    queue.Push("c.png");
+    queue.Push("d.png");
+
+    // Moved paths keep the given order, unknown paths are ignored
+    const std::vector<fs::path> visible{ "d.png", "x.png", "b.png" };
+    queue.MoveToFront(visible);
+    REQUIRE(queue.Size() == 4);
+    REQUIRE_FALSE(queue.Contains("x.png"));
+
+    REQUIRE(queue.Pop() == "d.png"_p);
+    REQUIRE(queue.Pop() == "b.png"_p);
+    REQUIRE(queue.Pop() == "a.png"_p);
+    REQUIRE(queue.Pop() == "c.png"_p);
+}
+
+TEST_CASE("Work queue pushes to front", "[work_queue_push_front]")
+{
+    WorkQueue queue{};
+    queue.Push("a.png");
+    queue.Push("b.png");
+
+    REQUIRE(queue.PushFront("c.png"));
+
+    // Already queued paths stay where they are
+    REQUIRE_FALSE(queue.PushFront("b.png"));
+    REQUIRE(queue.Size() == 3);
+
+    REQUIRE(queue.Pop() == "c.png"_p);
+    REQUIRE(queue.Pop() == "a.png"_p);
+    REQUIRE(queue.Pop() == "b.png"_p);
+}
+
+TEST_CASE("Work queue delays paths", "[work_queue_delayed]")
+{
+    const WorkQueue::Clock::time_point now{ WorkQueue::Clock::now() };
+
+    WorkQueue queue{};
+    queue.Push("a.png");
+    REQUIRE(queue.PushDelayed("b.png", now + std::chrono::seconds{ 2 }));
+    REQUIRE(queue.PushDelayed("c.png", now + std::chrono::seconds{ 1 }));
+
+    // Already queued or delayed paths are not delayed again
+    REQUIRE_FALSE(queue.PushDelayed("a.png", now));
+    REQUIRE_FALSE(queue.PushDelayed("b.png", now));
+    REQUIRE(queue.Contains("b.png"));
+    REQUIRE(queue.Size() == 1);
+    REQUIRE(queue.NextDelayed() == now + std::chrono::seconds{ 1 });
+
+    REQUIRE(queue.Pop(now) == "a.png"_p);
+    REQUIRE_FALSE(queue.Pop(now).has_value());
+
+    // Due paths are queued in the order they are due
+    REQUIRE(queue.Pop(now + std::chrono::seconds{ 2 }) == "c.png"_p);
+    REQUIRE(queue.Pop(now + std::chrono::seconds{ 2 }) == "b.png"_p);
+    REQUIRE_FALSE(queue.NextDelayed().has_value());
+
+    // Pushing a delayed path queues it right away
+    queue.PushDelayed("d.png", now + std::chrono::seconds{ 1 });
+    REQUIRE(queue.Push("d.png"));
+    REQUIRE_FALSE(queue.NextDelayed().has_value());
+    REQUIRE(queue.Pop(now) == "d.png"_p);
+
+    queue.PushDelayed("e.png", now + std::chrono::seconds{ 1 });
+    REQUIRE(queue.Remove("e.png"));
+    REQUIRE_FALSE(queue.Contains("e.png"));
+    REQUIRE(queue.Empty());
+}
+
+TEST_CASE("Work queue benchmark", "[.][work_queue_benchmark]")
+{
+    static constexpr size_t c_NumPaths{ 50'000 };
+
+    std::vector<fs::path> paths;
+    paths.reserve(c_NumPaths);
+    for (size_t i = 0; i < c_NumPaths; i++)
+    {
+        paths.push_back(fmt::format("card_{}.png", i));
+    }
+
+    BENCHMARK("Enqueue 50k paths")
+    {
+        WorkQueue queue{};
+        for (const fs::path& path : paths)
+        {
+            queue.Push(path);
+        }
+        return queue.Size();
+    };
+
+    BENCHMARK("Enqueue and drain 50k paths")
+    {
+        WorkQueue queue{};
+        for (const fs::path& path : paths)
+        {
+            queue.Push(path);
+        }
+        while (queue.Pop())
+            /* drain */;
+        return queue.Size();
+    };
+}